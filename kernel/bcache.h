@@ -0,0 +1,21 @@
+// Buffer cache size and statistics, see bcachectl().
+#define BCACHE_STAT    0  // copy a struct bcachestat to addr
+#define BCACHE_SETMAX  1  // cap the cache at n buffers
+#define BCACHE_RESET   2  // zero the counters
+#define BCACHE_CHECK   3  // exercise asynchronous I/O; 0 if it works
+
+struct bcachestat {
+  int nbuf;          // buffers now
+  int max;           // cap, settable
+  int minbuf;        // buffers never given back (NBUF)
+  int limit;         // highest possible cap (NBUFMAX)
+  uint64 hits;       // lookups that found the block cached
+  uint64 misses;     // ... that had to recycle a buffer
+  uint64 grows;      // pages of buffers added
+  uint64 reclaims;   // pages given back to kalloc
+  uint64 readahead;  // blocks read ahead of need
+  int lru;           // 1 if built with BCACHE_LRU, else 2Q
+  int probation;     // buffers seen once, recycled first
+  uint64 ghosthits;  // misses on blocks recently put off probation
+  uint64 metahits;   // hits on metadata blocks
+};
@@ -1,6 +1,6 @@
 // Buffer cache.
 //
-// The buffer cache is a linked list of buf structures holding
+// The buffer cache is a hash table of buf structures holding
 // cached copies of disk block contents.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
@@ -8,6 +8,8 @@
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
 // * After changing buffer data, call bwrite to write it to disk.
+// * To keep several requests in flight, use bread_async and
+//     bwrite_async, then bwait for each buffer.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
 // * Only one process at a time can use a buffer,
@@ -22,70 +24,430 @@
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "trace.h"
+#include "bcache.h"
 
-struct {
+#define NBUCKET 13  // hash buckets; prime, to spread block numbers
+
+// Buffers beyond the first NBUF come BPERPAGE to a page,
+// added while memory is plentiful and given back when
+// kalloc() runs out.
+#define BPERPAGE (PGSIZE / sizeof(struct buf))
+#define NBUFPAGE ((NBUFMAX - NBUF + BPERPAGE - 1) / BPERPAGE)
+#define MINFREE  1024  // free pages below which the cache stops growing
+
+// Buffers live in hash buckets keyed by (dev, blockno), each
+// with its own lock, so looking up a cached block, releasing
+// it and pinning it touch only that block's bucket. Eviction
+// picks the unused buffer with the oldest lastuse stamp in
+// any bucket; bcache.lock serializes evictions, growth and
+// reclaim, so at most one process ever holds several bucket
+// locks.
+struct bucket {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  uint64 hits;
+  uint64 metahits;
+  struct buf head;    // circular list through prev/next
+} __attribute__ ((aligned (CACHELINE)));
+
+// Replacement follows a simplified 2Q. A block read in goes
+// on probation (A1), where lastuse is its arrival time, and
+// hits leave it there. Metadata (see bmeta()), and blocks
+// missed again soon after leaving probation, which a ghost
+// list of recent departures remembers, join the main list
+// (AM) instead, in LRU order. Eviction takes the oldest
+// block on probation while probation holds more than a
+// quarter of the cache, so a long sequential read recycles
+// its own buffers rather than the inode, bitmap and directory
+// blocks every process uses. Build with BCACHE_LRU for plain
+// LRU: every block then goes on the main list.
+#define BQ_FREE 0  // not yet used; any eviction takes it
+#define BQ_A1   1  // probation, FIFO
+#define BQ_AM   2  // main list, LRU
+#define NGHOST  (NBUFMAX / 2)
+
+struct ghost {
+  uint dev;
+  uint blockno;
+  uint64 seq;  // bcache.gseq when it left probation; 0 if unused
+};
+
+struct {
+  struct spinlock lock;  // serializes evictions, growth, reclaim
+  struct buf buf[NBUF]; // each on its own cache lines
+  struct buf *page[NBUFPAGE];  // pages of more buffers
+  int npage;
+  int nbuf;              // NBUF + npage*BPERPAGE
+  int max;               // cap on nbuf
+  uint64 misses;
+  uint64 grows;
+  uint64 reclaims;
+  uint64 readahead;      // reads started by bprefetch()
+  int nprobation;        // buffers on BQ_A1
+  uint64 ghosthits;
+  uint64 gseq;
+  struct ghost ghost[NGHOST];  // ring, indexed by gseq
+  struct bucket bucket[NBUCKET];
+} bcache __attribute__ ((aligned (CACHELINE)));
+
+static struct bucket*
+bucketof(uint dev, uint blockno)
+{
+  return &bcache.bucket[(dev * 31 + blockno) % NBUCKET];
+}
 
-  // Linked list of all buffers, through prev/next.
-  // Sorted by how recently the buffer was used.
-  // head.next is most recent, head.prev is least.
-  struct buf head;
-} bcache;
+static void
+bunlink(struct buf *b)
+{
+  b->next->prev = b->prev;
+  b->prev->next = b->next;
+}
+
+static void
+blink(struct bucket *bk, struct buf *b)
+{
+  b->next = bk->head.next;
+  b->prev = &bk->head;
+  bk->head.next->prev = b;
+  bk->head.next = b;
+}
 
 void
 binit(void)
 {
   struct buf *b;
+  struct bucket *bk;
 
   initlock(&bcache.lock, "bcache");
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+    initlock(&bk->lock, "bcache.bucket");
+    bk->head.prev = &bk->head;
+    bk->head.next = &bk->head;
+  }
+  bcache.nbuf = NBUF;
+  bcache.max = NBUFMAX;
 
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
+  // Start all buffers in bucket 0; eviction spreads them.
   for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    blink(&bcache.bucket[0], b);
   }
 }
 
-// Look through buffer cache for block on device dev.
-// If not found, allocate a buffer.
-// In either case, return locked buffer.
+// Return the buffer for block (dev, blockno) in bucket bk,
+// with a reference taken, or 0. Caller holds bk->lock.
 static struct buf*
-bget(uint dev, uint blockno)
+bfind(struct bucket *bk, uint dev, uint blockno)
 {
   struct buf *b;
 
-  acquire(&bcache.lock);
-
-  // Is the block already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
+  for(b = bk->head.next; b != &bk->head; b = b->next){
     if(b->dev == dev && b->blockno == blockno){
       b->refcnt++;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
+      bk->hits++;
+      if(b->meta)
+        bk->metahits++;
       return b;
     }
   }
+  return 0;
+}
 
-  // Not cached.
-  // Recycle the least recently used (LRU) unused buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if(b->refcnt == 0) {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->valid = 0;
-      b->refcnt = 1;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+// Is there room, under the cap and in memory, for
+// another page of buffers? Caller holds bcache.lock.
+static int
+bcangrow(void)
+{
+  return bcache.npage < NBUFPAGE && bcache.nbuf + BPERPAGE <= bcache.max &&
+    kfreepages() > MINFREE;
+}
+
+// Add the buffers in page pg to the cache, unused, or free
+// pg if the cache has reached its cap meanwhile.
+// Caller holds bcache.lock.
+static void
+bgrow(char *pg)
+{
+  struct buf *b, *bp = (struct buf*)pg;
+
+  if(bcache.npage == NBUFPAGE || bcache.nbuf + BPERPAGE > bcache.max){
+    kfree(pg);
+    return;
+  }
+  for(b = bp; b < bp+BPERPAGE; b++){
+    memset(b, 0, sizeof(*b));
+    b->dev = -1;
+    initsleeplock(&b->lock, "buffer");
+  }
+  bcache.page[bcache.npage++] = bp;
+  bcache.nbuf += BPERPAGE;
+  bcache.grows++;
+  acquire(&bcache.bucket[0].lock);
+  for(b = bp; b < bp+BPERPAGE; b++)
+    blink(&bcache.bucket[0], b);
+  release(&bcache.bucket[0].lock);
+}
+
+// Give up to n pages of unused buffers back to kalloc(),
+// newest first. Returns the number of pages freed.
+// kalloc() calls this when memory runs out.
+int
+bcachereclaim(int n)
+{
+  struct bucket *bk;
+  struct buf *b, *bp;
+  int i, busy, nfreed;
+
+  if(bcache.npage == 0)
+    return 0;
+
+  acquire(&bcache.lock);
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++)
+    acquire(&bk->lock);
+  nfreed = 0;
+  for(i = bcache.npage - 1; i >= 0 && nfreed < n; i--){
+    bp = bcache.page[i];
+    busy = 0;
+    for(b = bp; b < bp+BPERPAGE; b++)
+      busy |= b->refcnt | b->disk;
+    if(busy)
+      continue;
+    for(b = bp; b < bp+BPERPAGE; b++){
+      if(b->queue == BQ_A1)
+        bcache.nprobation--;
+      bunlink(b);
+      freesleeplock(&b->lock);
+    }
+    kfree(bp);
+    bcache.page[i] = bcache.page[--bcache.npage];
+    bcache.nbuf -= BPERPAGE;
+    nfreed++;
+  }
+  bcache.reclaims += nfreed;
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++)
+    release(&bk->lock);
+  release(&bcache.lock);
+  return nfreed;
+}
+
+// Remember that a block left probation, in the ghost list.
+// Caller holds bcache.lock.
+static void
+ghostadd(uint dev, uint blockno)
+{
+  struct ghost *g;
+
+  bcache.gseq++;
+  g = &bcache.ghost[bcache.gseq % NGHOST];
+  g->dev = dev;
+  g->blockno = blockno;
+  g->seq = bcache.gseq;
+}
+
+// Which list should a block being read in join?
+// Caller holds bcache.lock.
+static int
+bqueue(uint dev, uint blockno)
+{
+#ifdef BCACHE_LRU
+  return BQ_AM;
+#else
+  struct ghost *g;
+  uint64 s;
+
+  // only the last nbuf/2 departures count as recent.
+  for(s = bcache.gseq; s > 0 && bcache.gseq - s < bcache.nbuf / 2; s--){
+    g = &bcache.ghost[s % NGHOST];
+    if(g->seq == s && g->dev == dev && g->blockno == blockno){
+      g->seq = 0;
+      bcache.ghosthits++;
+      return BQ_AM;
+    }
+  }
+  return BQ_A1;
+#endif
+}
+
+// Choose an unused buffer to recycle, in one pass over the
+// cache: the oldest on probation while probation holds more
+// than its share, else the least recently used on the main
+// list, else whichever there is. A never-used buffer is the
+// oldest of either. A buffer still being read ahead is in
+// use by the disk. Returns the buffer with its bucket's lock
+// held in *bkp, or 0. Caller holds bcache.lock.
+static struct buf*
+bvictim(struct bucket **bkp)
+{
+  struct bucket *vk, *a1k, *amk, *oa1k, *oamk;
+  struct buf *b, *a1, *am;
+
+  // keep the locks of the buckets holding the oldest so far.
+  a1 = am = 0;
+  a1k = amk = 0;
+  for(vk = bcache.bucket; vk < bcache.bucket+NBUCKET; vk++){
+    acquire(&vk->lock);
+    oa1k = a1k;
+    oamk = amk;
+    for(b = vk->head.next; b != &vk->head; b = b->next){
+      if(b->refcnt != 0 || b->disk != 0)
+        continue;
+      if(b->queue != BQ_AM && (a1 == 0 || b->lastuse < a1->lastuse)){
+        a1 = b;
+        a1k = vk;
+      }
+      if(b->queue != BQ_A1 && (am == 0 || b->lastuse < am->lastuse)){
+        am = b;
+        amk = vk;
+      }
     }
+    if(oa1k && oa1k != a1k && oa1k != amk)
+      release(&oa1k->lock);
+    if(oamk && oamk != oa1k && oamk != amk && oamk != a1k)
+      release(&oamk->lock);
+    if(a1k != vk && amk != vk)
+      release(&vk->lock);
+  }
+
+  if(a1 && (am == 0 || bcache.nprobation > bcache.nbuf / 4)){
+    if(amk && amk != a1k)
+      release(&amk->lock);
+    *bkp = a1k;
+    return a1;
   }
-  panic("bget: no buffers");
+  if(a1k && a1k != amk)
+    release(&a1k->lock);
+  *bkp = amk;
+  return am;
+}
+
+// Look through buffer cache for block on device dev.
+// If not found, allocate a buffer.
+// In either case, return locked buffer.
+static struct buf*
+bget(uint dev, uint blockno)
+{
+  struct bucket *bk = bucketof(dev, blockno);
+  struct bucket *best;
+  struct buf *b, *victim;
+  char *pg;
+  int q, nogrow;
+
+  // Is the block already cached?
+  acquire(&bk->lock);
+  b = bfind(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Not cached. Serialize with other evictions, and look
+  // again in case one of them just brought the block in.
+  acquire(&bcache.lock);
+  nogrow = 0;
+again:
+  acquire(&bk->lock);
+  b = bfind(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Take a never-used buffer if there is one. If not, add
+  // a page of them rather than evict, while memory allows.
+  // kalloc() may reclaim from the cache, so call it
+  // unlocked, and then look again from the start.
+  victim = bvictim(&best);
+  if(!nogrow && (victim == 0 || victim->queue != BQ_FREE) && bcangrow()){
+    if(victim)
+      release(&best->lock);
+    release(&bcache.lock);
+    pg = kalloc();
+    acquire(&bcache.lock);
+    if(pg)
+      bgrow(pg);
+    else
+      nogrow = 1;
+    goto again;
+  }
+  if(victim == 0)
+    panic("bget: no buffers");
+  bcache.misses++;
+  q = bqueue(dev, blockno);
+
+  // Recycle it.
+  if(victim->queue == BQ_A1){
+    bcache.nprobation--;
+    if(victim->valid)
+      ghostadd(victim->dev, victim->blockno);
+  }
+
+  // Move it to bk. Only evictions add buffers to a bucket,
+  // and no one else can find an unused buffer once it is
+  // unlinked, so it is safe to drop best's lock first.
+  bunlink(victim);
+  release(&best->lock);
+  acquire(&bk->lock);
+  victim->dev = dev;
+  victim->blockno = blockno;
+  victim->valid = 0;
+  victim->refcnt = 1;
+  victim->queue = q;
+  victim->meta = 0;
+  victim->lastuse = r_time();
+  if(q == BQ_A1)
+    bcache.nprobation++;
+  blink(bk, victim);
+  release(&bk->lock);
+  release(&bcache.lock);
+  acquiresleep(&victim->lock);
+  return victim;
+}
+
+// Return a locked buf for the indicated block, with a read
+// of its contents started if they aren't cached. Call bwait()
+// before using the data. Returns 1 in *started if this call
+// started a read.
+static struct buf*
+bstart(uint dev, uint blockno, int *started)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  *started = 0;
+  if(!b->valid) {
+    TRACE(EV_BREAD_MISS, blockno, 0);
+    // a read-ahead may already be under way.
+    if(!b->disk){
+      virtio_disk_submit(b, 0);
+      *started = 1;
+    }
+  } else
+    TRACE(EV_BREAD_HIT, blockno, 0);
+  return b;
+}
+
+// Like bread(), but don't wait for the disk: the caller can
+// start several reads, then bwait() for each.
+struct buf*
+bread_async(uint dev, uint blockno)
+{
+  int started;
+
+  return bstart(dev, blockno, &started);
+}
+
+// Wait for the disk to finish with locked buffer b; after a
+// read, b->data then holds the block.
+void
+bwait(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwait");
+  virtio_disk_wait(b);
+  b->valid = 1;
 }
 
 // Return a locked buf with the contents of the indicated block.
@@ -94,60 +456,204 @@ bread(uint dev, uint blockno)
 {
   struct buf *b;
 
-  b = bget(dev, blockno);
-  if(!b->valid) {
-    virtio_disk_rw(b, 0);
-    b->valid = 1;
-  }
+  b = bread_async(dev, blockno);
+  bwait(b);
   return b;
 }
 
+// Start reading the indicated block into the cache, if it
+// isn't there, and return without waiting for the disk.
+// The buffer stays in the cache while the disk has it.
+void
+bprefetch(uint dev, uint blockno)
+{
+  struct buf *b;
+  int started;
+
+  b = bstart(dev, blockno, &started);
+  if(started)
+    __sync_fetch_and_add(&bcache.readahead, 1);
+  brelse(b);
+}
+
+// Start writing b's contents to disk; b must be locked, and
+// stay locked and unchanged until bwait(). If done is not 0,
+// the disk interrupt calls done(b) when the write finishes,
+// so it must not sleep.
+void
+bwrite_async(struct buf *b, void (*done)(struct buf*))
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwrite_async");
+  b->iodone = done;
+  virtio_disk_submit(b, 1);
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
 {
   if(!holdingsleep(&b->lock))
     panic("bwrite");
-  virtio_disk_rw(b, 1);
+  bwrite_async(b, 0);
+  bwait(b);
 }
 
 // Release a locked buffer.
-// Move to the head of the most-recently-used list.
+// Stamp it with the time, for LRU eviction from the
+// main list; probation is first in, first out.
 void
 brelse(struct buf *b)
 {
+  struct bucket *bk;
+
   if(!holdingsleep(&b->lock))
     panic("brelse");
 
   releasesleep(&b->lock);
 
-  acquire(&bcache.lock);
+  bk = bucketof(b->dev, b->blockno);
+  acquire(&bk->lock);
   b->refcnt--;
-  if (b->refcnt == 0) {
+  if (b->refcnt == 0 && b->queue != BQ_A1) {
     // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
-  }
-  
-  release(&bcache.lock);
+    b->lastuse = r_time();
+  }
+  release(&bk->lock);
 }
 
 void
 bpin(struct buf *b) {
-  acquire(&bcache.lock);
+  struct bucket *bk = bucketof(b->dev, b->blockno);
+
+  acquire(&bk->lock);
   b->refcnt++;
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 
 void
 bunpin(struct buf *b) {
-  acquire(&bcache.lock);
+  struct bucket *bk = bucketof(b->dev, b->blockno);
+
+  acquire(&bk->lock);
   b->refcnt--;
+  release(&bk->lock);
+}
+
+// Mark locked buffer b as holding file system metadata,
+// which the cache keeps on the main list.
+void
+bmeta(struct buf *b)
+{
+  struct bucket *bk;
+
+  if(!holdingsleep(&b->lock))
+    panic("bmeta");
+  // only its holder changes a buffer in use.
+  if(b->meta)
+    return;
+  bk = bucketof(b->dev, b->blockno);
+  acquire(&bcache.lock);
+  acquire(&bk->lock);
+  b->meta = 1;
+  if(b->queue == BQ_A1){
+    b->queue = BQ_AM;
+    bcache.nprobation--;
+  }
+  release(&bk->lock);
   release(&bcache.lock);
 }
 
+extern struct superblock sb;  // fs.c
+static int ncheckdone;
+
+static void
+bcheckdone(struct buf *b)
+{
+  __sync_fetch_and_add(&ncheckdone, 1);
+}
+
+// Check the asynchronous interface: read 2*NLOGIO blocks of
+// the on-disk log with the reads all in flight, then write
+// them back unchanged the same way, counting completion
+// callbacks. The log changes these blocks only under their
+// buffer locks, which this holds throughout.
+static int
+bcheck(void)
+{
+  struct buf *b[2*NLOGIO];
+  int i, n;
 
+  for(i = 0; i < 2*NLOGIO; i++)
+    b[i] = bread_async(ROOTDEV, sb.logstart + i);
+  for(i = 0; i < 2*NLOGIO; i++)
+    bwait(b[i]);
+  n = __atomic_load_n(&ncheckdone, __ATOMIC_RELAXED);
+  for(i = 0; i < 2*NLOGIO; i++)
+    bwrite_async(b[i], bcheckdone);
+  for(i = 0; i < 2*NLOGIO; i++)
+    bwait(b[i]);
+  n = __atomic_load_n(&ncheckdone, __ATOMIC_RELAXED) - n;
+  for(i = 0; i < 2*NLOGIO; i++)
+    brelse(b[i]);
+  return n == 2*NLOGIO ? 0 : -1;
+}
+
+// bcachectl(op, addr, n): report cache statistics, set the
+// cap on the number of buffers, reset the counters, or
+// check asynchronous I/O.
+int
+bcachectl(int op, uint64 addr, int n)
+{
+  struct bcachestat st;
+  struct bucket *bk;
+
+  switch(op){
+  case BCACHE_STAT:
+    memset(&st, 0, sizeof(st));
+    acquire(&bcache.lock);
+    st.nbuf = bcache.nbuf;
+    st.max = bcache.max;
+    st.minbuf = NBUF;
+    st.limit = NBUFMAX;
+    st.misses = bcache.misses;
+    st.grows = bcache.grows;
+    st.reclaims = bcache.reclaims;
+    st.readahead = bcache.readahead;
+#ifdef BCACHE_LRU
+    st.lru = 1;
+#endif
+    st.probation = bcache.nprobation;
+    st.ghosthits = bcache.ghosthits;
+    release(&bcache.lock);
+    for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+      st.hits += __atomic_load_n(&bk->hits, __ATOMIC_RELAXED);
+      st.metahits += __atomic_load_n(&bk->metahits, __ATOMIC_RELAXED);
+    }
+    return either_copyout(1, addr, &st, sizeof(st));
+  case BCACHE_SETMAX:
+    if(n < NBUF || n > NBUFMAX)
+      return -1;
+    acquire(&bcache.lock);
+    bcache.max = n;
+    release(&bcache.lock);
+    // buffers in use stay until the next reclaim.
+    while(bcache.nbuf > n && bcachereclaim(1) > 0)
+      ;
+    return 0;
+  case BCACHE_RESET:
+    acquire(&bcache.lock);
+    bcache.misses = bcache.grows = bcache.reclaims = bcache.readahead = 0;
+    bcache.ghosthits = 0;
+    release(&bcache.lock);
+    for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+      acquire(&bk->lock);
+      bk->hits = bk->metahits = 0;
+      release(&bk->lock);
+    }
+    return 0;
+  case BCACHE_CHECK:
+    return bcheck();
+  }
+  return -1;
+}
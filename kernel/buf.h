@@ -1,12 +1,19 @@
+// The first group of fields is read by bget() scans
+// under the bucket's lock; the sleep-lock and the data
+// are used by the buffer's holder, on lines of their own.
 struct buf {
-  int valid;   // has data been read from disk?
-  int disk;    // does disk "own" buf?
   uint dev;
   uint blockno;
-  struct sleeplock lock;
   uint refcnt;
-  struct buf *prev; // LRU cache list
+  uint64 lastuse;   // r_time() when read in, or last released
+  uchar queue;      // replacement list, BQ_* in bio.c
+  uchar meta;       // holds file system metadata, see bmeta()
+  struct buf *prev; // hash bucket list
   struct buf *next;
-  uchar data[BSIZE];
-};
 
+  struct sleeplock lock __attribute__ ((aligned (CACHELINE)));
+  int valid;   // has data been read from disk?
+  int disk;    // does disk "own" buf?
+  void (*iodone)(struct buf*);  // bwrite_async() callback
+  uchar data[BSIZE] __attribute__ ((aligned (CACHELINE)));
+};
@@ -20,7 +20,9 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "defs.h"
+#include "rusage.h"
 #include "proc.h"
+#include "poll.h"
 
 #define BACKSPACE 0x100
 #define C(x)  ((x)-'@')  // Control-x
@@ -126,6 +128,22 @@ consoleread(int user_dst, uint64 dst, int n)
   return target - n;
 }
 
+//
+// input is ready once a whole line has arrived;
+// output never waits.
+//
+int
+consolepoll(void)
+{
+  int ev = POLLOUT;
+
+  acquire(&cons.lock);
+  if(cons.r != cons.w)
+    ev |= POLLIN;
+  release(&cons.lock);
+  return ev;
+}
+
 //
 // the console input interrupt handler.
 // uartintr() calls this for input character.
@@ -170,6 +188,7 @@ consoleintr(int c)
         // has arrived.
         cons.w = cons.e;
         wakeup(&cons.r);
+        pollwakeup();
       }
     }
     break;
@@ -185,8 +204,9 @@ consoleinit(void)
 
   uartinit();
 
-  // connect read and write system calls
-  // to consoleread and consolewrite.
+  // connect read, write and poll system calls
+  // to consoleread, consolewrite and consolepoll.
   devsw[CONSOLE].read = consoleread;
   devsw[CONSOLE].write = consolewrite;
+  devsw[CONSOLE].poll = consolepoll;
 }
@@ -1,21 +1,33 @@
 struct buf;
 struct context;
+struct endpoint;
 struct file;
 struct inode;
+struct iovec;
+struct lockprof;
 struct pipe;
 struct proc;
 struct spinlock;
+struct sqe;
 struct sleeplock;
 struct stat;
+struct uclock;
 struct superblock;
 
 // bio.c
+int             bcachereclaim(int);
+int             bcachectl(int, uint64, int);
 void            binit(void);
 struct buf*     bread(uint, uint);
+void            bprefetch(uint, uint);
+struct buf*     bread_async(uint, uint);
+void            bwait(struct buf*);
+void            bwrite_async(struct buf*, void (*)(struct buf*));
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bmeta(struct buf*);
 
 // console.c
 void            consoleinit(void);
@@ -33,6 +45,11 @@ void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
+int             filereadv(struct file*, struct iovec*, int);
+int             filewritev(struct file*, struct iovec*, int);
+int             filepread(struct file*, uint64, int, uint);
+int             filepwrite(struct file*, uint64, int, uint);
+int             filesend(struct file*, struct file*, uint*, int);
 
 // fs.c
 void            fsinit(int);
@@ -42,9 +59,12 @@ struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
 void            iinit();
 void            ilock(struct inode*);
+void            ilock_shared(struct inode*);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
+void            iunlock_shared(struct inode*);
 void            iunlockput(struct inode*);
+void            iunlockput_shared(struct inode*);
 void            iupdate(struct inode*);
 int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
@@ -59,11 +79,25 @@ void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// ipc.c
+int             endpointalloc(struct file**);
+void            endpointclose(struct endpoint*);
+int             ipccall(struct endpoint*, uint64);
+int             ipcrecv(struct file*, uint64);
+int             ipcreply(struct endpoint*, uint64);
+void            ipcabandon(void);
+
 // kalloc.c
 void*           kalloc(void);
+int             kfreepages(void);
 void            kfree(void *);
 void            kinit(void);
 
+// latency.c
+extern int      lattracing;
+void            latrecord(int, uint64, uint64);
+int             latstat(int, uint64, int);
+
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
@@ -73,14 +107,29 @@ void            end_op(void);
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, uint64, int);
-int             pipewrite(struct pipe*, uint64, int);
+int             piperead(struct pipe*, int, uint64, int, int);
+int             pipewrite(struct pipe*, int, uint64, int, int);
+int             pipepoll(struct pipe*, int);
+int             pipesize(struct pipe*, int);
+int             pipegift(struct pipe*, uint64, int, int);
+
+// poll.c
+void            pollwakeup(void);
+void            polltick(void);
+int             filepoll(struct file*);
+int             poll(uint64, int, int);
 
 // printf.c
 void            printf(char*, ...);
 void            panic(char*) __attribute__((noreturn));
 void            printfinit(void);
 
+// prof.c
+extern int      profiling;
+void            profuser(struct proc*);
+void            profkernel(uint64, uint64);
+int             profctl(int, uint64, int);
+
 // proc.c
 int             cpuid(void);
 void            exit(int);
@@ -98,8 +147,10 @@ void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
-int             wait(uint64);
+int             wait4(int, uint64, int, uint64);
 void            wakeup(void*);
+void            handoff(struct proc*, void*);
+void            cycacct(struct proc*, int);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
@@ -110,17 +161,25 @@ void            swtch(struct context*, struct context*);
 
 // spinlock.c
 void            acquire(struct spinlock*);
+void            addlock(struct lockprof*, char*, int);
+void            freelock(struct spinlock*);
+void            dellock(struct lockprof*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+int             lockstat(uint64, int);
+void            lockstatreset(void);
 void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
+void            acquiresleep_shared(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
+void            releasesleep_shared(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
+void            freesleeplock(struct sleeplock*);
 
 // string.c
 int             memcmp(const void*, const void*, uint);
@@ -131,6 +190,9 @@ int             strlen(const char*);
 int             strncmp(const char*, const char*, uint);
 char*           strncpy(char*, const char*, int);
 
+// sysfile.c
+int             ringop(struct sqe*);
+
 // syscall.c
 int             argint(int, int*);
 int             argstr(int, char*, int);
@@ -139,11 +201,24 @@ int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
 
+// systrace.c
+extern int      systracing;
+void            traceenter(struct proc*, int);
+void            traceexit(struct proc*, int);
+int             systrace(int, uint64, int);
+
+// trace.c
+extern int      evtracing;
+void            tracepoint(int, uint64, uint64);
+int             tracectl(int, uint64, int);
+#define TRACE(type, a0, a1) do { if(evtracing) tracepoint(type, a0, a1); } while(0)
+
 // trap.c
 extern uint     ticks;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
+extern struct uclock *uclock;
 void            usertrapret(void);
 
 // uart.c
@@ -153,6 +228,11 @@ void            uartputc(int);
 void            uartputc_sync(int);
 int             uartgetc(void);
 
+// uring.c
+uint64          ringsetup(void);
+void            ringfree(struct proc*, pagetable_t);
+int             ringenter(int);
+
 // vm.c
 void            kvminit(void);
 void            kvminithart(void);
@@ -167,6 +247,7 @@ void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
 uint64          walkaddr(pagetable_t, uint64);
+uint64          uvmswap(pagetable_t, uint64, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
 int             copyinstr(pagetable_t, char *, uint64, uint64);
@@ -180,6 +261,8 @@ void            plic_complete(int);
 // virtio_disk.c
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
+void            virtio_disk_submit(struct buf *, int);
+void            virtio_disk_wait(struct buf *);
 void            virtio_disk_intr(void);
 
 // number of elements in fixed-size array
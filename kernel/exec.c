@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "defs.h"
 #include "elf.h"
@@ -27,7 +28,7 @@ exec(char *path, char **argv)
     end_op();
     return -1;
   }
-  ilock(ip);
+  ilock_shared(ip);
 
   // Check ELF header
   if(readi(ip, 0, (uint64)&elf, 0, sizeof(elf)) != sizeof(elf))
@@ -57,7 +58,7 @@ exec(char *path, char **argv)
     if(loadseg(pagetable, ph.vaddr, ip, ph.off, ph.filesz) < 0)
       goto bad;
   }
-  iunlockput(ip);
+  iunlockput_shared(ip);
   end_op();
   ip = 0;
 
@@ -114,6 +115,7 @@ exec(char *path, char **argv)
   p->sz = sz;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
+  ringfree(p, oldpagetable);
   proc_freepagetable(oldpagetable, oldsz);
 
   return argc; // this ends up in a0, the first argument to main(argc, argv)
@@ -122,7 +124,7 @@ exec(char *path, char **argv)
   if(pagetable)
     proc_freepagetable(pagetable, sz);
   if(ip){
-    iunlockput(ip);
+    iunlockput_shared(ip);
     end_op();
   }
   return -1;
@@ -10,14 +10,17 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "uio.h"
+#include "poll.h"
 #include "stat.h"
+#include "rusage.h"
 #include "proc.h"
 
 struct devsw devsw[NDEV];
 struct {
   struct spinlock lock;
-  struct file file[NFILE];
-} ftable;
+  struct file file[NFILE] __attribute__ ((aligned (CACHELINE)));
+} ftable __attribute__ ((aligned (CACHELINE)));
 
 void
 fileinit(void)
@@ -35,6 +38,7 @@ filealloc(void)
   for(f = ftable.file; f < ftable.file + NFILE; f++){
     if(f->ref == 0){
       f->ref = 1;
+      f->nonblock = 0;
       release(&ftable.lock);
       return f;
     }
@@ -75,6 +79,8 @@ fileclose(struct file *f)
 
   if(ff.type == FD_PIPE){
     pipeclose(ff.pipe, ff.writable);
+  } else if(ff.type == FD_ENDPOINT){
+    endpointclose(ff.endpoint);
   } else if(ff.type == FD_INODE || ff.type == FD_DEVICE){
     begin_op();
     iput(ff.ip);
@@ -91,9 +97,9 @@ filestat(struct file *f, uint64 addr)
   struct stat st;
   
   if(f->type == FD_INODE || f->type == FD_DEVICE){
-    ilock(f->ip);
+    ilock_shared(f->ip);
     stati(f->ip, &st);
-    iunlock(f->ip);
+    iunlock_shared(f->ip);
     if(copyout(p->pagetable, addr, (char *)&st, sizeof(st)) < 0)
       return -1;
     return 0;
@@ -101,10 +107,47 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
-// Read from file f.
-// addr is a user virtual address.
-int
-fileread(struct file *f, uint64 addr, int n)
+// Most bytes written to an inode in one log transaction:
+// a few blocks at a time, to avoid exceeding the maximum
+// log transaction size, including i-node, indirect block,
+// allocation blocks, and 2 blocks of slop for non-aligned
+// writes. this really belongs lower down, since writei()
+// might be writing a device like the console.
+#define WRITEMAX (((MAXOPBLOCKS-1-1-2) / 2) * BSIZE)
+
+// Write n bytes from addr to ip at *off, advancing *off,
+// one transaction at a time. addr is a user virtual address
+// if user_src, else a kernel address.
+static int
+writeinode(struct inode *ip, int user_src, uint64 addr, int n, uint *off)
+{
+  int max = WRITEMAX;
+  int r, i = 0;
+
+  while(i < n){
+    int n1 = n - i;
+    if(n1 > max)
+      n1 = max;
+
+    begin_op();
+    ilock(ip);
+    if ((r = writei(ip, user_src, addr + i, *off, n1)) > 0)
+      *off += r;
+    iunlock(ip);
+    end_op();
+
+    if(r != n1){
+      // error from writei
+      break;
+    }
+    i += r;
+  }
+  return (i == n ? n : -1);
+}
+
+// Read from file f into a user (user_dst) or kernel address.
+static int
+readfile(struct file *f, int user_dst, uint64 addr, int n)
 {
   int r = 0;
 
@@ -112,14 +155,16 @@ fileread(struct file *f, uint64 addr, int n)
     return -1;
 
   if(f->type == FD_PIPE){
-    r = piperead(f->pipe, addr, n);
+    r = piperead(f->pipe, user_dst, addr, n, f->nonblock);
   } else if(f->type == FD_DEVICE){
     if(f->major < 0 || f->major >= NDEV || !devsw[f->major].read)
       return -1;
-    r = devsw[f->major].read(1, addr, n);
+    if(f->nonblock && devsw[f->major].poll && !(devsw[f->major].poll() & POLLIN))
+      return -1;
+    r = devsw[f->major].read(user_dst, addr, n);
   } else if(f->type == FD_INODE){
     ilock(f->ip);
-    if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
+    if((r = readi(f->ip, user_dst, addr, f->off, n)) > 0)
       f->off += r;
     iunlock(f->ip);
   } else {
@@ -129,54 +174,214 @@ fileread(struct file *f, uint64 addr, int n)
   return r;
 }
 
-// Write to file f.
-// addr is a user virtual address.
-int
-filewrite(struct file *f, uint64 addr, int n)
+// Write to file f from a user (user_src) or kernel address.
+static int
+writefile(struct file *f, int user_src, uint64 addr, int n)
 {
-  int r, ret = 0;
+  int ret = 0;
 
   if(f->writable == 0)
     return -1;
 
   if(f->type == FD_PIPE){
-    ret = pipewrite(f->pipe, addr, n);
+    ret = pipewrite(f->pipe, user_src, addr, n, f->nonblock);
   } else if(f->type == FD_DEVICE){
     if(f->major < 0 || f->major >= NDEV || !devsw[f->major].write)
       return -1;
-    ret = devsw[f->major].write(1, addr, n);
+    ret = devsw[f->major].write(user_src, addr, n);
   } else if(f->type == FD_INODE){
-    // write a few blocks at a time to avoid exceeding
-    // the maximum log transaction size, including
-    // i-node, indirect block, allocation blocks,
-    // and 2 blocks of slop for non-aligned writes.
-    // this really belongs lower down, since writei()
-    // might be writing a device like the console.
-    int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
-      if(n1 > max)
-        n1 = max;
-
-      begin_op();
-      ilock(f->ip);
-      if ((r = writei(f->ip, 1, addr + i, f->off, n1)) > 0)
-        f->off += r;
-      iunlock(f->ip);
-      end_op();
+    ret = writeinode(f->ip, user_src, addr, n, &f->off);
+  } else {
+    panic("filewrite");
+  }
+
+  return ret;
+}
+
+// Read from file f.
+// addr is a user virtual address.
+int
+fileread(struct file *f, uint64 addr, int n)
+{
+  return readfile(f, 1, addr, n);
+}
+
+// Write to file f.
+// addr is a user virtual address.
+int
+filewrite(struct file *f, uint64 addr, int n)
+{
+  return writefile(f, 1, addr, n);
+}
+
+// Copy up to n bytes from file in to file out without a
+// trip through user space: a page at a time, read into a
+// kernel bounce page and written straight back out. If off
+// is not null, in is an inode read from *off, which is
+// advanced, rather than from in->off. Stops early at end
+// of file, or after a short read, so that a pipe that has
+// delivered some data isn't waited on again. Returns the
+// number of bytes copied.
+int
+filesend(struct file *out, struct file *in, uint *off, int n)
+{
+  char *buf;
+  int m, r, w, tot;
+
+  if(in->readable == 0 || out->writable == 0 || n < 0)
+    return -1;
+  if(off && in->type != FD_INODE)
+    return -1;
+  if((buf = kalloc()) == 0)
+    return -1;
 
+  tot = 0;
+  while(tot < n){
+    m = n - tot;
+    if(m > PGSIZE)
+      m = PGSIZE;
+    if(off){
+      ilock_shared(in->ip);
+      if((r = readi(in->ip, 0, (uint64)buf, *off, m)) > 0)
+        *off += r;
+      iunlock_shared(in->ip);
+    } else {
+      r = readfile(in, 0, (uint64)buf, m);
+    }
+    if(r <= 0){
+      if(r < 0 && tot == 0)
+        tot = -1;
+      break;
+    }
+    w = writefile(out, 0, (uint64)buf, r);
+    if(w > 0)
+      tot += w;
+    if(w != r){
+      if(tot == 0)
+        tot = -1;
+      break;
+    }
+    if(r < m)
+      break;
+  }
+  kfree(buf);
+  return tot;
+}
+
+// Read from file f into the user buffers in iov[0..cnt-1].
+// An inode is locked once for the whole call. A pipe or
+// device gets a single read, into the first buffer that
+// is not empty, so that readv() doesn't block once some
+// data has arrived.
+int
+filereadv(struct file *f, struct iovec *iov, int cnt)
+{
+  int i, r, tot;
+
+  if(f->readable == 0)
+    return -1;
+
+  if(f->type != FD_INODE){
+    for(i = 0; i < cnt; i++)
+      if(iov[i].iov_len > 0)
+        return fileread(f, (uint64)iov[i].iov_base, iov[i].iov_len);
+    return 0;
+  }
+
+  tot = 0;
+  ilock(f->ip);
+  for(i = 0; i < cnt; i++){
+    r = readi(f->ip, 1, (uint64)iov[i].iov_base, f->off, iov[i].iov_len);
+    if(r < 0){
+      tot = -1;
+      break;
+    }
+    f->off += r;
+    tot += r;
+    if(r < iov[i].iov_len)
+      break;
+  }
+  iunlock(f->ip);
+  return tot;
+}
+
+// Write the user buffers in iov[0..cnt-1] to file f.
+// For an inode, as many buffers as fit in one log
+// transaction share a single begin_op()/end_op().
+int
+filewritev(struct file *f, struct iovec *iov, int cnt)
+{
+  int max = WRITEMAX;
+  int i, n1, r, room, tot;
+  uint64 o;
+
+  if(f->writable == 0)
+    return -1;
+
+  if(f->type != FD_INODE){
+    tot = 0;
+    for(i = 0; i < cnt; i++){
+      if((r = filewrite(f, (uint64)iov[i].iov_base, iov[i].iov_len)) < 0)
+        return -1;
+      tot += r;
+    }
+    return tot;
+  }
+
+  tot = 0;
+  i = 0;
+  o = 0;  // bytes of iov[i] already written
+  while(i < cnt){
+    begin_op();
+    ilock(f->ip);
+    for(room = max; i < cnt && room > 0; room -= n1){
+      n1 = iov[i].iov_len - o;
+      if(n1 > room)
+        n1 = room;
+      if((r = writei(f->ip, 1, (uint64)iov[i].iov_base + o, f->off, n1)) > 0){
+        f->off += r;
+        tot += r;
+      }
       if(r != n1){
         // error from writei
-        break;
+        iunlock(f->ip);
+        end_op();
+        return -1;
+      }
+      o += n1;
+      if(o == iov[i].iov_len){
+        i++;
+        o = 0;
       }
-      i += r;
     }
-    ret = (i == n ? n : -1);
-  } else {
-    panic("filewrite");
+    iunlock(f->ip);
+    end_op();
   }
+  return tot;
+}
 
-  return ret;
+// Read from file f at offset off, leaving f->off alone.
+// Only inodes have offsets. The inode is locked shared,
+// so processes sharing f can pread() it concurrently.
+int
+filepread(struct file *f, uint64 addr, int n, uint off)
+{
+  int r;
+
+  if(f->readable == 0 || f->type != FD_INODE)
+    return -1;
+  ilock_shared(f->ip);
+  r = readi(f->ip, 1, addr, off, n);
+  iunlock_shared(f->ip);
+  return r;
+}
+
+// Write to file f at offset off, leaving f->off alone.
+int
+filepwrite(struct file *f, uint64 addr, int n, uint off)
+{
+  if(f->writable == 0 || f->type != FD_INODE)
+    return -1;
+  return writeinode(f->ip, 1, addr, n, &off);
 }
 
@@ -1,9 +1,11 @@
 struct file {
-  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE } type;
+  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE, FD_ENDPOINT } type;
   int ref; // reference count
   char readable;
   char writable;
+  char nonblock;     // O_NONBLOCK: fail rather than wait
   struct pipe *pipe; // FD_PIPE
+  struct endpoint *endpoint; // FD_ENDPOINT
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
   short major;       // FD_DEVICE
@@ -27,12 +29,18 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+
+  // read-ahead hints, see readahead().
+  uint ralast;        // last block of the previous read
+  uint rawin;         // blocks to keep read ahead; 0 if random
+  uint raend;         // first block not yet read ahead
 };
 
 // map major device number to device functions.
 struct devsw {
   int (*read)(int, uint64, int);
   int (*write)(int, uint64, int);
+  int (*poll)(void);  // POLL* bits now ready; null if I/O never blocks
 };
 
 extern struct devsw devsw[];
@@ -15,6 +15,7 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -46,6 +47,19 @@ fsinit(int dev) {
   initlog(dev, &sb);
 }
 
+// Read a block of file system metadata: the bitmap, inodes,
+// indirect blocks. The buffer cache keeps these ahead of
+// file data.
+static struct buf*
+mread(uint dev, uint bno)
+{
+  struct buf *bp;
+
+  bp = bread(dev, bno);
+  bmeta(bp);
+  return bp;
+}
+
 // Zero a block.
 static void
 bzero(int dev, int bno)
@@ -69,7 +83,7 @@ balloc(uint dev)
 
   bp = 0;
   for(b = 0; b < sb.size; b += BPB){
-    bp = bread(dev, BBLOCK(b, sb));
+    bp = mread(dev, BBLOCK(b, sb));
     for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
       m = 1 << (bi % 8);
       if((bp->data[bi/8] & m) == 0){  // Is block free?
@@ -92,7 +106,7 @@ bfree(int dev, uint b)
   struct buf *bp;
   int bi, m;
 
-  bp = bread(dev, BBLOCK(b, sb));
+  bp = mread(dev, BBLOCK(b, sb));
   bi = b % BPB;
   m = 1 << (bi % 8);
   if((bp->data[bi/8] & m) == 0)
@@ -173,8 +187,8 @@ bfree(int dev, uint b)
 
 struct {
   struct spinlock lock;
-  struct inode inode[NINODE];
-} itable;
+  struct inode inode[NINODE] __attribute__ ((aligned (CACHELINE)));
+} itable __attribute__ ((aligned (CACHELINE)));
 
 void
 iinit()
@@ -200,7 +214,7 @@ ialloc(uint dev, short type)
   struct dinode *dip;
 
   for(inum = 1; inum < sb.ninodes; inum++){
-    bp = bread(dev, IBLOCK(inum, sb));
+    bp = mread(dev, IBLOCK(inum, sb));
     dip = (struct dinode*)bp->data + inum%IPB;
     if(dip->type == 0){  // a free inode
       memset(dip, 0, sizeof(*dip));
@@ -224,7 +238,7 @@ iupdate(struct inode *ip)
   struct buf *bp;
   struct dinode *dip;
 
-  bp = bread(ip->dev, IBLOCK(ip->inum, sb));
+  bp = mread(ip->dev, IBLOCK(ip->inum, sb));
   dip = (struct dinode*)bp->data + ip->inum%IPB;
   dip->type = ip->type;
   dip->major = ip->major;
@@ -267,6 +281,7 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
+  ip->ralast = ip->rawin = ip->raend = 0;
   release(&itable.lock);
 
   return ip;
@@ -297,7 +312,7 @@ ilock(struct inode *ip)
   acquiresleep(&ip->lock);
 
   if(ip->valid == 0){
-    bp = bread(ip->dev, IBLOCK(ip->inum, sb));
+    bp = mread(ip->dev, IBLOCK(ip->inum, sb));
     dip = (struct dinode*)bp->data + ip->inum%IPB;
     ip->type = dip->type;
     ip->major = dip->major;
@@ -312,6 +327,25 @@ ilock(struct inode *ip)
   }
 }
 
+// Lock the given inode shared with other readers, for
+// paths that only readi(), stati() or dirlookup() it.
+// readi() never allocates blocks, since xv6 files have
+// no holes below ip->size.
+void
+ilock_shared(struct inode *ip)
+{
+  if(ip == 0 || ip->ref < 1)
+    panic("ilock_shared");
+
+  // Only ilock() reads the inode from disk. valid cannot go
+  // back to 0 while we hold a reference, so check it first.
+  if(ip->valid == 0){
+    ilock(ip);
+    iunlock(ip);
+  }
+  acquiresleep_shared(&ip->lock);
+}
+
 // Unlock the given inode.
 void
 iunlock(struct inode *ip)
@@ -322,6 +356,15 @@ iunlock(struct inode *ip)
   releasesleep(&ip->lock);
 }
 
+void
+iunlock_shared(struct inode *ip)
+{
+  if(ip == 0 || ip->ref < 1)
+    panic("iunlock_shared");
+
+  releasesleep_shared(&ip->lock);
+}
+
 // Drop a reference to an in-memory inode.
 // If that was the last reference, the inode table entry can
 // be recycled.
@@ -365,6 +408,13 @@ iunlockput(struct inode *ip)
   iput(ip);
 }
 
+void
+iunlockput_shared(struct inode *ip)
+{
+  iunlock_shared(ip);
+  iput(ip);
+}
+
 // Inode content
 //
 // The content (data) associated with each inode is stored
@@ -391,7 +441,7 @@ bmap(struct inode *ip, uint bn)
     // Load indirect block, allocating if necessary.
     if((addr = ip->addrs[NDIRECT]) == 0)
       ip->addrs[NDIRECT] = addr = balloc(ip->dev);
-    bp = bread(ip->dev, addr);
+    bp = mread(ip->dev, addr);
     a = (uint*)bp->data;
     if((addr = a[bn]) == 0){
       a[bn] = addr = balloc(ip->dev);
@@ -433,6 +483,7 @@ itrunc(struct inode *ip)
   }
 
   ip->size = 0;
+  ip->ralast = ip->rawin = ip->raend = 0;
   iupdate(ip);
 }
 
@@ -448,6 +499,49 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+#define RAMIN   4   // first read-ahead window, in blocks
+#define RAMAX  16   // largest window
+// Blocks read ahead are unevictable only while in flight,
+// at most NDISKIO of them, which NBUF leaves room for.
+
+// Reads of ip are about to touch blocks bn..last. If they
+// follow on from the previous read, or span several blocks,
+// they look sequential: start or double the read-ahead
+// window. Otherwise close it.
+static void
+rawindow(struct inode *ip, uint bn, uint last)
+{
+  if(bn == ip->ralast || bn == ip->ralast + 1 || last > bn){
+    ip->rawin = ip->rawin ? ip->rawin * 2 : RAMIN;
+    if(ip->rawin > RAMAX)
+      ip->rawin = RAMAX;
+  } else {
+    ip->rawin = 0;
+    ip->raend = 0;
+  }
+  ip->ralast = last;
+}
+
+// Start reading blocks bn up to the read-ahead window past
+// it, without waiting, skipping those already started.
+// The window fields are hints: readers that hold ip shared
+// may race on them, costing a redundant or missed
+// read-ahead, never wrong data, since bread() still checks.
+static void
+readahead(struct inode *ip, uint bn)
+{
+  uint b, end, nblocks;
+
+  nblocks = (ip->size + BSIZE - 1) / BSIZE;
+  end = bn + 1 + ip->rawin;
+  if(end > nblocks)
+    end = nblocks;
+  b = ip->raend > bn && ip->raend <= end ? ip->raend : bn;
+  for(; b < end; b++)
+    bprefetch(ip->dev, bmap(ip, b));
+  ip->raend = end;
+}
+
 // Read data from inode.
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
@@ -457,14 +551,25 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  struct proc *p = myproc();
 
   if(off > ip->size || off + n < off)
     return 0;
   if(off + n > ip->size)
     n = ip->size - off;
+  if(n == 0)
+    return 0;
 
+  rawindow(ip, off/BSIZE, (off + n - 1)/BSIZE);
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
+    // keep the window at least half full ahead of us.
+    if(ip->rawin && off/BSIZE + ip->rawin/2 >= ip->raend)
+      readahead(ip, off/BSIZE);
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
+    if(ip->type == T_DIR)
+      bmeta(bp);
+    if(p)
+      p->ru.inblock++;
     m = min(n - tot, BSIZE - off%BSIZE);
     if(either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1) {
       brelse(bp);
@@ -488,6 +593,7 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  struct proc *p = myproc();
 
   if(off > ip->size || off + n < off)
     return -1;
@@ -496,11 +602,15 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
 
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
+    if(ip->type == T_DIR)
+      bmeta(bp);
     m = min(n - tot, BSIZE - off%BSIZE);
     if(either_copyin(bp->data + (off % BSIZE), user_src, src, m) == -1) {
       brelse(bp);
       break;
     }
+    if(p)
+      p->ru.oublock++;
     log_write(bp);
     brelse(bp);
   }
@@ -636,21 +746,21 @@ namex(char *path, int nameiparent, char *name)
     ip = idup(myproc()->cwd);
 
   while((path = skipelem(path, name)) != 0){
-    ilock(ip);
+    ilock_shared(ip);
     if(ip->type != T_DIR){
-      iunlockput(ip);
+      iunlockput_shared(ip);
       return 0;
     }
     if(nameiparent && *path == '\0'){
       // Stop one level early.
-      iunlock(ip);
+      iunlock_shared(ip);
       return ip;
     }
     if((next = dirlookup(ip, name, 0)) == 0){
-      iunlockput(ip);
+      iunlockput_shared(ip);
       return 0;
     }
-    iunlockput(ip);
+    iunlockput_shared(ip);
     ip = next;
   }
   if(nameiparent){
@@ -0,0 +1,235 @@
+//
+// Synchronous IPC endpoints, in the style of L4.
+//
+// A client calls an endpoint with a small message: a few
+// message registers plus an optional buffer. The call is
+// copied straight from the client's address space into that
+// of a server waiting in ipcrecv(), and the client blocks
+// until the server's ipcreply() is copied back the same way.
+// Both directions hand the CPU directly to the woken process
+// (see handoff() in proc.c), so a round trip costs two
+// syscalls on each side and no scheduler scan.
+//
+// An endpoint serves one call at a time; further callers
+// wait until the current call has been answered and a server
+// is again waiting in ipcrecv(). A server holds a reference
+// to the endpoint (p->ipcfile) until it answers; if it exits,
+// or receives another call, first, the caller gets -1.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "fs.h"
+#include "sleeplock.h"
+#include "file.h"
+#include "ipc.h"
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+struct endpoint {
+  struct spinlock lock;
+  struct proc *server;   // process waiting in ipcrecv(), or 0
+  uint64 smsg;           // where its message goes
+  struct proc *caller;   // process whose call is in progress, or 0
+  int callerpid;         // its pid, for ipcrecv() after it has gone
+  uint64 cmsg;           // where its reply goes
+  struct proc *handler;  // server that received the call
+  int replied;           // handler has answered caller
+  int status;            // 0, or -1 if the reply could not be delivered
+};
+
+int
+endpointalloc(struct file **f)
+{
+  struct endpoint *ep;
+
+  if((*f = filealloc()) == 0)
+    return -1;
+  if((ep = (struct endpoint*)kalloc()) == 0){
+    fileclose(*f);
+    return -1;
+  }
+  memset(ep, 0, sizeof(*ep));
+  initlock(&ep->lock, "endpoint");
+  (*f)->type = FD_ENDPOINT;
+  (*f)->readable = 0;
+  (*f)->writable = 0;
+  (*f)->endpoint = ep;
+  return 0;
+}
+
+// Called when the last file reference is closed. No process
+// can be inside ipccall/ipcrecv/ipcreply, since each holds
+// a reference through its file descriptor.
+void
+endpointclose(struct endpoint *ep)
+{
+  freelock(&ep->lock);
+  kfree((char*)ep);
+}
+
+// Copy the message at src in pagetable spt into the message
+// at dst in pagetable dpt: the registers, and as much of the
+// buffer as dst has room for. Sets dst's len.
+// Returns 0 on success, -1 on error.
+static int
+ipcxfer(pagetable_t dpt, uint64 dst, pagetable_t spt, uint64 src)
+{
+  struct ipcmsg sm, dm;
+  char chunk[256];
+  int n, off, m;
+
+  if(copyin(spt, (char*)&sm, src, sizeof(sm)) < 0 ||
+     copyin(dpt, (char*)&dm, dst, sizeof(dm)) < 0)
+    return -1;
+  n = sm.buf ? sm.len : 0;
+  if(n < 0 || n > IPC_MAXBUF)
+    return -1;
+  n = dm.buf ? min(n, dm.size) : 0;
+  for(off = 0; off < n; off += m){
+    m = min(n - off, sizeof(chunk));
+    if(copyin(spt, chunk, sm.buf + off, m) < 0 ||
+       copyout(dpt, dm.buf + off, chunk, m) < 0)
+      return -1;
+  }
+  memmove(dm.mr, sm.mr, sizeof(dm.mr));
+  dm.len = n;
+  return copyout(dpt, dst, (char*)&dm, sizeof(dm));
+}
+
+// Send the message at user address msg to a server waiting on
+// ep, then wait for its reply, which overwrites msg.
+int
+ipccall(struct endpoint *ep, uint64 msg)
+{
+  struct proc *p = myproc();
+  struct proc *s;
+
+  acquire(&ep->lock);
+  while(ep->server == 0 || ep->caller != 0){
+    if(p->killed){
+      release(&ep->lock);
+      return -1;
+    }
+    sleep(&ep->caller, &ep->lock);
+  }
+
+  // the server sleeps in ipcrecv() until we clear ep->server,
+  // so its page table stays put while we copy into it.
+  s = ep->server;
+  if(ipcxfer(s->pagetable, ep->smsg, p->pagetable, msg) < 0){
+    release(&ep->lock);
+    return -1;
+  }
+  ep->server = 0;
+  ep->caller = p;
+  ep->callerpid = p->pid;
+  ep->cmsg = msg;
+  ep->handler = s;
+  ep->replied = 0;
+  ep->status = 0;
+  handoff(s, &ep->server);
+
+  while(!ep->replied){
+    if(p->killed)
+      break;
+    sleep(&ep->replied, &ep->lock);
+  }
+  int r = ep->replied ? ep->status : -1;
+  ep->caller = 0;
+  ep->handler = 0;
+  wakeup(&ep->caller);
+  release(&ep->lock);
+  return r;
+}
+
+// Give up any call this process received and has not
+// answered: its caller, if still waiting, gets -1.
+void
+ipcabandon(void)
+{
+  struct proc *p = myproc();
+  struct file *f = p->ipcfile;
+  struct endpoint *ep;
+
+  if(f == 0)
+    return;
+  p->ipcfile = 0;
+  ep = f->endpoint;
+  acquire(&ep->lock);
+  if(ep->handler == p && !ep->replied){
+    ep->status = -1;
+    ep->replied = 1;
+    wakeup(&ep->replied);
+  }
+  release(&ep->lock);
+  fileclose(f);
+}
+
+// Wait for a call on endpoint file f and copy it to user
+// address msg. Returns the caller's pid.
+int
+ipcrecv(struct file *f, uint64 msg)
+{
+  struct proc *p = myproc();
+  struct endpoint *ep = f->endpoint;
+  int pid;
+
+  ipcabandon();
+  acquire(&ep->lock);
+  if(ep->server != 0){
+    // another server is already waiting.
+    release(&ep->lock);
+    return -1;
+  }
+  ep->server = p;
+  ep->smsg = msg;
+  wakeup(&ep->caller);
+  while(ep->server == p){
+    if(p->killed){
+      ep->server = 0;
+      release(&ep->lock);
+      return -1;
+    }
+    sleep(&ep->server, &ep->lock);
+  }
+  // a killed caller may already have given up on the call.
+  pid = ep->callerpid;
+  release(&ep->lock);
+  // keep ep alive until we answer, even if f is closed.
+  p->ipcfile = filedup(f);
+  return pid;
+}
+
+// Answer the call this process received on ep with the
+// message at user address msg.
+int
+ipcreply(struct endpoint *ep, uint64 msg)
+{
+  struct proc *p = myproc();
+  struct proc *c;
+  int r;
+
+  acquire(&ep->lock);
+  c = ep->caller;
+  if(c == 0 || ep->handler != p || ep->replied){
+    release(&ep->lock);
+    r = -1;
+  } else {
+    // the caller sleeps in ipccall() until ep->replied is set.
+    r = ipcxfer(c->pagetable, ep->cmsg, p->pagetable, msg);
+    ep->status = r;
+    ep->replied = 1;
+    handoff(c, &ep->replied);
+    release(&ep->lock);
+  }
+  // the call is over, answered or not.
+  if(p->ipcfile && p->ipcfile->endpoint == ep)
+    ipcabandon();
+  return r;
+}
@@ -0,0 +1,11 @@
+// Synchronous IPC messages, see ipc.c.
+
+#define IPC_NMR     4     // message registers per message
+#define IPC_MAXBUF  1024  // max bytes in a message's buffer
+
+struct ipcmsg {
+  uint64 mr[IPC_NMR]; // message registers
+  uint64 buf;         // optional user buffer, or 0
+  int len;            // bytes of buf holding the message
+  int size;           // capacity of buf for a received message
+};
@@ -14,6 +14,8 @@ void freerange(void *pa_start, void *pa_end);
 extern char end[]; // first address after kernel.
                    // defined by kernel.ld.
 
+#define RECLAIM 8  // cache pages to reclaim when memory runs out
+
 struct run {
   struct run *next;
 };
@@ -21,7 +23,8 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
-} kmem;
+  int nfree;          // pages on freelist
+} kmem __attribute__ ((aligned (CACHELINE)));
 
 void
 kinit()
@@ -59,24 +62,40 @@ kfree(void *pa)
   acquire(&kmem.lock);
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
   release(&kmem.lock);
 }
 
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
+// When memory runs out, unused buffer-cache pages are
+// given back; so a caller must not hold bcache locks.
 void *
 kalloc(void)
 {
   struct run *r;
 
-  acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  release(&kmem.lock);
+  for(;;){
+    acquire(&kmem.lock);
+    r = kmem.freelist;
+    if(r){
+      kmem.freelist = r->next;
+      kmem.nfree--;
+    }
+    release(&kmem.lock);
+    if(r || bcachereclaim(RECLAIM) == 0)
+      break;
+  }
 
   if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
   return (void*)r;
 }
+
+// Number of free pages, without reclaiming any.
+int
+kfreepages(void)
+{
+  return __atomic_load_n(&kmem.nfree, __ATOMIC_RELAXED);
+}
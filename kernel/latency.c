@@ -0,0 +1,121 @@
+//
+// Interrupts-off and spinlock-hold latency by call site.
+// While lattracing is set, pop_off() and release() report
+// each interval's length and starting pc here. Each CPU
+// keeps its own tables and only touches them with
+// interrupts off, so recording takes no lock. Like
+// spinlock.c, this file must not be instrumented by KCSAN.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+#include "latency.h"
+
+#define NLATSITE 64   // call sites per CPU and kind, a power of two
+
+int lattracing;
+
+struct {
+  struct latsite site[2][NLATSITE];   // [LAT_IRQOFF or LAT_HOLD]
+  uint64 lost;                        // intervals with no free slot
+} lat[NCPU] __attribute__ ((aligned (CACHELINE)));
+
+// Record an interval of length t started at pc.
+// Interrupts must be off.
+void
+latrecord(int kind, uint64 pc, uint64 t)
+{
+  struct latsite *tab = lat[cpuid()].site[kind];
+  struct latsite *s;
+  int i, h;
+
+  h = (pc >> 2) & (NLATSITE-1);
+  for(i = 0; i < NLATSITE; i++){
+    s = &tab[(h + i) & (NLATSITE-1)];
+    if(s->pc == pc || s->pc == 0){
+      s->pc = pc;
+      s->count++;
+      s->total += t;
+      if(t > s->max)
+        s->max = t;
+      return;
+    }
+  }
+  lat[cpuid()].lost++;
+}
+
+// Merge all CPUs' tables for kind and copy the n sites
+// with the longest intervals, worst first, to user
+// address addr. Returns the number copied, or -1.
+static int
+latread(int kind, uint64 addr, int n)
+{
+  struct latsite *m, *s, t;
+  int c, i, j, nm;
+
+  if((m = (struct latsite *)kalloc()) == 0)
+    return -1;
+  nm = 0;
+  for(c = 0; c < NCPU; c++){
+    for(i = 0; i < NLATSITE; i++){
+      s = &lat[c].site[kind][i];
+      if(s->pc == 0)
+        continue;
+      for(j = 0; j < nm; j++)
+        if(m[j].pc == s->pc)
+          break;
+      if(j == nm){
+        if(nm == PGSIZE / sizeof(*m))
+          continue;
+        memset(&m[nm++], 0, sizeof(*m));
+        m[j].pc = s->pc;
+      }
+      m[j].count += s->count;
+      m[j].total += s->total;
+      if(s->max > m[j].max)
+        m[j].max = s->max;
+    }
+  }
+
+  if(n > nm)
+    n = nm;
+  for(i = 0; i < n; i++){
+    for(j = i + 1; j < nm; j++){
+      if(m[j].max > m[i].max){
+        t = m[i];
+        m[i] = m[j];
+        m[j] = t;
+      }
+    }
+  }
+  if(n > 0 && copyout(myproc()->pagetable, addr, (char *)m, n * sizeof(*m)) < 0)
+    n = -1;
+  kfree((char *)m);
+  return n;
+}
+
+int
+latstat(int op, uint64 addr, int n)
+{
+  switch(op){
+  case LAT_START:
+    lattracing = 0;
+    memset(lat, 0, sizeof(lat));
+    lattracing = 1;
+    return 0;
+  case LAT_STOP:
+    lattracing = 0;
+    return 0;
+  case LAT_READ_IRQOFF:
+    return latread(LAT_IRQOFF, addr, n);
+  case LAT_READ_HOLD:
+    return latread(LAT_HOLD, addr, n);
+  }
+  return -1;
+}
@@ -0,0 +1,19 @@
+// Interrupts-off and spinlock-hold latency, see latstat().
+
+#define LAT_IRQOFF  0   // intervals with interrupts disabled by push_off()
+#define LAT_HOLD    1   // intervals holding a spinlock
+
+// latstat(op, addr, n) operations
+#define LAT_START   0   // zero the tables and start timing
+#define LAT_STOP    1
+#define LAT_READ_IRQOFF 2  // copy the n worst LAT_IRQOFF sites to addr
+#define LAT_READ_HOLD   3  // copy the n worst LAT_HOLD sites to addr
+
+// One call site: the pc that called push_off() or
+// acquire() to start the interval.
+struct latsite {
+  uint64 pc;
+  uint64 count;         // intervals started here
+  uint64 max;           // longest, in rdtime units
+  uint64 total;         // sum of their lengths
+};
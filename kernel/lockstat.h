@@ -0,0 +1,14 @@
+// Lock contention statistics, see lockstat().
+#define LOCKSTAT_READ   0   // copy out stats, aggregated by name
+#define LOCKSTAT_RESET  1   // zero all counters
+
+struct lockstat {
+  char name[16];      // lock name
+  int sleep;          // 1 if a sleep-lock
+  int nlock;          // number of locks with this name
+  uint64 nacquire;    // acquisitions
+  uint64 ncontend;    // ... that found the lock held
+  uint64 nwait;       // spin iterations, or sleeps for sleep-locks
+  uint64 nspun;       // sleep-locks: contended, but won by spinning
+  uint64 holdtime;    // time held, in timer (r_time) units
+};
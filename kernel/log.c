@@ -6,6 +6,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "trace.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
@@ -64,21 +65,33 @@ initlog(int dev, struct superblock *sb)
   recover_from_log();
 }
 
-// Copy committed blocks from log to their home location
+// Copy committed blocks from log to their home location,
+// NLOGIO at a time, with their reads and writes in flight
+// together.
 static void
 install_trans(int recovering)
 {
-  int tail;
-
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block
-    struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
-    bwrite(dbuf);  // write dst to disk
-    if(recovering == 0)
-      bunpin(dbuf);
-    brelse(lbuf);
-    brelse(dbuf);
+  struct buf *lbuf[NLOGIO], *dbuf[NLOGIO];
+  int tail, i, n;
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail;
+    if(n > NLOGIO)
+      n = NLOGIO;
+    for (i = 0; i < n; i++)
+      lbuf[i] = bread_async(log.dev, log.start+tail+i+1); // read log block
+    for (i = 0; i < n; i++) {
+      dbuf[i] = bread(log.dev, log.lh.block[tail+i]); // read dst
+      bwait(lbuf[i]);
+      memmove(dbuf[i]->data, lbuf[i]->data, BSIZE);  // copy block to dst
+      brelse(lbuf[i]);
+      // write dst to disk; it may leave the cache once there.
+      bwrite_async(dbuf[i], recovering ? 0 : bunpin);
+    }
+    for (i = 0; i < n; i++) {
+      bwait(dbuf[i]);
+      brelse(dbuf[i]);
+    }
   }
 }
 
@@ -126,6 +139,7 @@ recover_from_log(void)
 void
 begin_op(void)
 {
+  TRACE(EV_BEGIN_OP, 0, 0);
   acquire(&log.lock);
   while(1){
     if(log.committing){
@@ -135,6 +149,7 @@ begin_op(void)
       sleep(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      TRACE(EV_BEGIN_OK, log.outstanding, 0);
       release(&log.lock);
       break;
     }
@@ -178,15 +193,25 @@ end_op(void)
 static void
 write_log(void)
 {
-  int tail;
-
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *to = bread(log.dev, log.start+tail+1); // log block
-    struct buf *from = bread(log.dev, log.lh.block[tail]); // cache block
-    memmove(to->data, from->data, BSIZE);
-    bwrite(to);  // write the log
-    brelse(from);
-    brelse(to);
+  struct buf *to[NLOGIO];
+  int tail, i, n;
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail;
+    if(n > NLOGIO)
+      n = NLOGIO;
+    for (i = 0; i < n; i++) {
+      to[i] = bread(log.dev, log.start+tail+i+1); // log block
+      struct buf *from = bread(log.dev, log.lh.block[tail+i]); // cache block
+      memmove(to[i]->data, from->data, BSIZE);
+      bwrite_async(to[i], 0);  // write the log
+      brelse(from);
+    }
+    // all must be on disk before write_head() commits.
+    for (i = 0; i < n; i++) {
+      bwait(to[i]);
+      brelse(to[i]);
+    }
   }
 }
 
@@ -194,11 +219,16 @@ static void
 commit()
 {
   if (log.lh.n > 0) {
+    TRACE(EV_COMMIT, COMMIT_START, log.lh.n);
     write_log();     // Write modified blocks from cache to log
+    TRACE(EV_COMMIT, COMMIT_LOGGED, log.lh.n);
     write_head();    // Write header to disk -- the real commit
+    TRACE(EV_COMMIT, COMMIT_HEAD, log.lh.n);
     install_trans(0); // Now install writes to home locations
+    TRACE(EV_COMMIT, COMMIT_INSTALL, log.lh.n);
     log.lh.n = 0;
     write_head();    // Erase the transaction from the log
+    TRACE(EV_COMMIT, COMMIT_DONE, 0);
   }
 }
 
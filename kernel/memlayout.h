@@ -29,6 +29,7 @@
 #define CLINT 0x2000000L
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
+#define TIMEBASE 10000000L // CLINT_MTIME (and rdtime) cycles per second.
 
 // qemu puts platform-level interrupt controller (PLIC) here.
 #define PLIC 0x0c000000L
@@ -62,6 +63,32 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   URING (p->uring, if the process has called ringsetup())
+//   UCLOCK (read-only, shared by all processes)
+//   USYSCALL (read-only, p->usyscall)
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+
+// Per-process state that user code can read without a
+// system call.
+#define USYSCALL (TRAPFRAME - PGSIZE)
+
+struct usyscall {
+  int pid;  // Process ID
+};
+
+// Clock state published by clockintr() under a seqlock
+// (see seqlock.h), so that user code can read it without
+// a system call.
+#define UCLOCK (USYSCALL - PGSIZE)
+
+struct uclock {
+  uint seq;          // seqlock count
+  uint ticks;        // timer interrupts since boot
+  uint64 ticktime;   // rdtime at the last of them
+  uint64 freq;       // rdtime cycles per second
+};
+
+// Submission and completion rings, see uring.h.
+#define URING (UCLOCK - PGSIZE)
@@ -3,11 +3,16 @@
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
+#define NLOCK       (500+2*NBUFMAX)  // maximum number of locks, for lockstat
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define NDISKIO      10  // most disk requests in flight at once
+#define NLOGIO        4  // log blocks in flight to the disk at once
+#define NBUF         (LOGSIZE+NDISKIO+2*NLOGIO)  // minimum size of disk block cache
+#define NBUFMAX      FSSIZE  // most buffers the block cache grows to
 #define FSSIZE       1000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define PIPEMAX      65536 // max bytes a pipe buffers; power-of-2 pages
@@ -3,22 +3,34 @@
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "poll.h"
 
-#define PIPESIZE 512
+// A pipe buffers up to size bytes (at most PIPEMAX) in
+// pages allocated as the writer gets ahead of the reader.
+// Byte i lives in page[(i / PGSIZE) % NPIPEPAGE], so the
+// pages form a ring that never needs moving as it grows.
+// Once the reader catches up, all pages but the one the
+// next write will use are freed.
+#define NPIPEPAGE (PIPEMAX / PGSIZE)
 
 struct pipe {
   struct spinlock lock;
-  char data[PIPESIZE];
+  char *page[NPIPEPAGE];
+  uint size;      // capacity in bytes, a multiple of PGSIZE
   uint nread;     // number of bytes read
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  int wwait;      // a writer is asleep on nwrite
 };
 
+#define PAGEOF(pi, i)  (&(pi)->page[((i) / PGSIZE) % NPIPEPAGE])
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -30,6 +42,10 @@ pipealloc(struct file **f0, struct file **f1)
     goto bad;
   if((pi = (struct pipe*)kalloc()) == 0)
     goto bad;
+  memset(pi, 0, sizeof(*pi));
+  if((pi->page[0] = kalloc()) == 0)
+    goto bad;
+  pi->size = PIPEMAX;
   pi->readopen = 1;
   pi->writeopen = 1;
   pi->nwrite = 0;
@@ -55,9 +71,34 @@ pipealloc(struct file **f0, struct file **f1)
   return -1;
 }
 
+// Free every page but the one holding byte nwrite,
+// moving a page there if need be. The pipe is empty,
+// so the next write can start on a page boundary,
+// which lets pipegift() hand over whole pages.
+static void
+pipeshrink(struct pipe *pi)
+{
+  char **keep;
+  int i;
+
+  pi->nread = pi->nwrite = PGROUNDUP(pi->nwrite);
+  keep = PAGEOF(pi, pi->nwrite);
+  for(i = 0; i < NPIPEPAGE; i++){
+    if(pi->page[i] == 0 || &pi->page[i] == keep)
+      continue;
+    if(*keep == 0)
+      *keep = pi->page[i];
+    else
+      kfree(pi->page[i]);
+    pi->page[i] = 0;
+  }
+}
+
 void
 pipeclose(struct pipe *pi, int writable)
 {
+  int i;
+
   acquire(&pi->lock);
   if(writable){
     pi->writeopen = 0;
@@ -66,17 +107,31 @@ pipeclose(struct pipe *pi, int writable)
     pi->readopen = 0;
     wakeup(&pi->nwrite);
   }
+  pollwakeup();
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
+    freelock(&pi->lock);
+    for(i = 0; i < NPIPEPAGE; i++)
+      if(pi->page[i])
+        kfree(pi->page[i]);
     kfree((char*)pi);
   } else
     release(&pi->lock);
 }
 
+// Write n bytes from addr, a user virtual address if
+// user_src, else a kernel address. If nonblock, return
+// what fit without waiting, or -1 if nothing did.
+// Bytes are copied in runs that end where a page or
+// the pipe fills, and readers are woken only when the
+// pipe stops being empty, the only time they could be
+// waiting.
 int
-pipewrite(struct pipe *pi, uint64 addr, int n)
+pipewrite(struct pipe *pi, int user_src, uint64 addr, int n, int nonblock)
 {
-  int i = 0;
+  int i = 0, m;
+  uint w;
+  char **pg;
   struct proc *pr = myproc();
 
   acquire(&pi->lock);
@@ -85,46 +140,191 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
       release(&pi->lock);
       return -1;
     }
-    if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
-      wakeup(&pi->nread);
+    pg = PAGEOF(pi, pi->nwrite);
+    if(pi->nwrite - pi->nread >= pi->size ||  //DOC: pipewrite-full
+       (*pg == 0 && (*pg = kalloc()) == 0)){
+      if(nonblock){
+        if(i == 0)
+          i = -1;
+        break;
+      }
+      pi->wwait = 1;
       sleep(&pi->nwrite, &pi->lock);
     } else {
-      char ch;
-      if(copyin(pr->pagetable, &ch, addr + i, 1) == -1)
+      w = pi->nwrite % PGSIZE;
+      m = n - i;
+      if(m > pi->nread + pi->size - pi->nwrite)
+        m = pi->nread + pi->size - pi->nwrite;
+      if(m > PGSIZE - w)
+        m = PGSIZE - w;
+      if(either_copyin(*pg + w, user_src, addr + i, m) == -1)
         break;
-      pi->data[pi->nwrite++ % PIPESIZE] = ch;
-      i++;
+      if(pi->nwrite == pi->nread){
+        wakeup(&pi->nread);
+        pollwakeup();
+      }
+      pi->nwrite += m;
+      i += m;
     }
   }
-  wakeup(&pi->nread);
   release(&pi->lock);
 
   return i;
 }
 
+// Read up to n bytes into addr (user virtual if user_dst),
+// waiting for data unless nonblock, when an empty pipe
+// gives -1. Writers are woken only if one is waiting.
 int
-piperead(struct pipe *pi, uint64 addr, int n)
+piperead(struct pipe *pi, int user_dst, uint64 addr, int n, int nonblock)
 {
-  int i;
+  int i, m, full;
+  uint r;
+  uint64 old;
+  char **pg;
   struct proc *pr = myproc();
-  char ch;
 
   acquire(&pi->lock);
   while(pi->nread == pi->nwrite && pi->writeopen){  //DOC: pipe-empty
-    if(pr->killed){
+    if(pr->killed || nonblock){
       release(&pi->lock);
       return -1;
     }
     sleep(&pi->nread, &pi->lock); //DOC: piperead-sleep
   }
-  for(i = 0; i < n; i++){  //DOC: piperead-copy
-    if(pi->nread == pi->nwrite)
+  full = pi->nwrite - pi->nread >= pi->size;
+  for(i = 0; i < n && pi->nread != pi->nwrite; i += m){  //DOC: piperead-copy
+    r = pi->nread % PGSIZE;
+    m = n - i;
+    if(m > pi->nwrite - pi->nread)
+      m = pi->nwrite - pi->nread;
+    if(m > PGSIZE - r)
+      m = PGSIZE - r;
+    pg = PAGEOF(pi, pi->nread);
+    // a whole page bound for a whole user page: trade pages.
+    if(m == PGSIZE && user_dst && (addr + i) % PGSIZE == 0 && addr + i < pr->sz &&
+       (old = uvmswap(pr->pagetable, addr + i, (uint64)*pg)) != 0){
+      *pg = (char*)old;
+    } else if(either_copyout(user_dst, addr + i, *pg + r, m) == -1)
       break;
-    ch = pi->data[pi->nread++ % PIPESIZE];
-    if(copyout(pr->pagetable, addr + i, &ch, 1) == -1)
+    pi->nread += m;
+  }
+  if(pi->nread == pi->nwrite)
+    pipeshrink(pi);
+  if(i > 0 && pi->wwait){
+    pi->wwait = 0;
+    wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  }
+  if(i > 0 && full)
+    pollwakeup();
+  release(&pi->lock);
+  return i;
+}
+
+// vmsplice(): move the n bytes of page-aligned user memory
+// at addr into the pipe by unmapping each page and putting
+// it in the ring; the writer gets a zero-filled page in its
+// place. Returns bytes moved. If the ring is mid-page after
+// a write(), wait as if full until the reader empties it,
+// when pipeshrink() aligns it again; if nonblock, or out of
+// memory, return what was moved, or -1 if nothing was.
+int
+pipegift(struct pipe *pi, uint64 addr, int n, int nonblock)
+{
+  int i = 0;
+  char **pg, *mem;
+  uint64 old;
+  struct proc *pr = myproc();
+
+  if(addr % PGSIZE || n % PGSIZE || addr + n > pr->sz)
+    return -1;
+
+  acquire(&pi->lock);
+  while(i < n){
+    if(pi->readopen == 0 || pr->killed){
+      release(&pi->lock);
+      return -1;
+    }
+    if(pi->nwrite % PGSIZE || pi->nwrite - pi->nread + PGSIZE > pi->size){
+      if(nonblock){
+        if(i == 0)
+          i = -1;
+        break;
+      }
+      pi->wwait = 1;
+      sleep(&pi->nwrite, &pi->lock);
+      continue;
+    }
+    // no reader would wake us once memory frees up.
+    pg = PAGEOF(pi, pi->nwrite);
+    if(*pg == 0 && (*pg = kalloc()) == 0){
+      if(i == 0)
+        i = -1;
       break;
+    }
+    // the ring's spare page, cleared, replaces the gift.
+    mem = *pg;
+    memset(mem, 0, PGSIZE);
+    if((old = uvmswap(pr->pagetable, addr + i, (uint64)mem)) == 0){
+      if(i == 0)
+        i = -1;
+      break;
+    }
+    *pg = (char*)old;
+    if(pi->nwrite == pi->nread){
+      wakeup(&pi->nread);
+      pollwakeup();
+    }
+    pi->nwrite += PGSIZE;
+    i += PGSIZE;
   }
-  wakeup(&pi->nwrite);  //DOC: piperead-wakeup
   release(&pi->lock);
   return i;
 }
+
+// Set the capacity to n bytes, rounded up to whole pages,
+// if n > 0. Fails if the pipe holds more than that.
+// Returns the capacity.
+int
+pipesize(struct pipe *pi, int n)
+{
+  acquire(&pi->lock);
+  if(n > 0){
+    if(n > PIPEMAX || PGROUNDUP(n) < pi->nwrite - pi->nread){
+      release(&pi->lock);
+      return -1;
+    }
+    pi->size = PGROUNDUP(n);
+    // writers may now fit, or polls may see a full pipe.
+    if(pi->wwait){
+      pi->wwait = 0;
+      wakeup(&pi->nwrite);
+    }
+    pollwakeup();
+  }
+  n = pi->size;
+  release(&pi->lock);
+  return n;
+}
+
+// POLL* bits for the read (writable == 0) or write end.
+int
+pipepoll(struct pipe *pi, int writable)
+{
+  int ev = 0;
+
+  acquire(&pi->lock);
+  if(writable){
+    if(pi->readopen == 0)
+      ev |= POLLERR;
+    else if(pi->nwrite - pi->nread < pi->size)
+      ev |= POLLOUT;
+  } else {
+    if(pi->nread != pi->nwrite)
+      ev |= POLLIN;
+    if(pi->writeopen == 0)
+      ev |= POLLIN|POLLHUP;  // read() returns 0
+  }
+  release(&pi->lock);
+  return ev;
+}
@@ -0,0 +1,160 @@
+//
+// poll(): wait until one of several files is ready.
+//
+// There is one wait channel for all pollers. Anything that
+// can make a file ready -- pipe reads, writes and closes,
+// console input -- calls pollwakeup(), which bumps pollseq
+// and wakes every poller to check its files again. Pollers
+// are rare and few, so this is cheaper than per-file wait
+// lists, and pollwakeup() costs a load when nobody polls.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "fs.h"
+#include "sleeplock.h"
+#include "file.h"
+#include "defs.h"
+#include "poll.h"
+
+struct {
+  struct spinlock lock;
+  uint seq;       // bumped by each pollwakeup()
+  int npoll;      // processes inside poll()
+  int ntimed;     // ... of which have a timeout
+} polls = { .lock.name = "poll" };
+
+// Something may have become ready. Called with the
+// object's own lock held, after changing its state.
+void
+pollwakeup(void)
+{
+  if(__atomic_load_n(&polls.npoll, __ATOMIC_ACQUIRE) == 0)
+    return;
+  acquire(&polls.lock);
+  polls.seq++;
+  wakeup(&polls);
+  release(&polls.lock);
+}
+
+// Clock tick: let pollers with a timeout check the time.
+void
+polltick(void)
+{
+  if(__atomic_load_n(&polls.ntimed, __ATOMIC_RELAXED) == 0)
+    return;
+  acquire(&polls.lock);
+  wakeup(&polls);
+  release(&polls.lock);
+}
+
+// Return the POLL* bits that currently apply to f.
+int
+filepoll(struct file *f)
+{
+  int ev;
+
+  switch(f->type){
+  case FD_PIPE:
+    return pipepoll(f->pipe, f->writable);
+  case FD_DEVICE:
+    if(f->major < 0 || f->major >= NDEV)
+      return POLLNVAL;
+    if(devsw[f->major].poll)
+      return devsw[f->major].poll();
+    // no hook: reads and writes don't block.
+    ev = 0;
+    if(devsw[f->major].read)
+      ev |= POLLIN;
+    if(devsw[f->major].write)
+      ev |= POLLOUT;
+    return ev;
+  case FD_INODE:
+    return POLLIN|POLLOUT;
+  default:
+    return POLLNVAL;
+  }
+}
+
+// Check each fd in fds[0..n-1] and fill in revents.
+// Return the number with something to report.
+static int
+pollscan(struct pollfd *fds, int n)
+{
+  struct proc *p = myproc();
+  struct file *f;
+  int i, ev, ready;
+
+  ready = 0;
+  for(i = 0; i < n; i++){
+    fds[i].revents = 0;
+    if(fds[i].fd < 0)
+      continue;
+    if(fds[i].fd >= NOFILE || (f = p->ofile[fds[i].fd]) == 0){
+      fds[i].revents = POLLNVAL;
+    } else {
+      ev = filepoll(f);
+      if(!f->readable)
+        ev &= ~POLLIN;
+      if(!f->writable)
+        ev &= ~POLLOUT;
+      // errors are reported whether asked for or not.
+      fds[i].revents = ev & (fds[i].events | POLLERR|POLLHUP|POLLNVAL);
+    }
+    if(fds[i].revents)
+      ready++;
+  }
+  return ready;
+}
+
+// Wait until one of the n pollfds at user address addr
+// is ready or timeout ticks pass; a negative timeout
+// waits forever. Return the number of ready fds, 0 on
+// timeout, or -1.
+int
+poll(uint64 addr, int n, int timeout)
+{
+  struct proc *p = myproc();
+  struct pollfd fds[NOFILE];
+  uint seq, t0;
+  int r;
+
+  if(n < 0 || n > NOFILE)
+    return -1;
+  if(copyin(p->pagetable, (char*)fds, addr, n * sizeof(fds[0])) < 0)
+    return -1;
+
+  acquire(&tickslock);
+  t0 = ticks;
+  release(&tickslock);
+
+  acquire(&polls.lock);
+  polls.npoll++;
+  if(timeout > 0)
+    polls.ntimed++;
+  for(;;){
+    // a wakeup after this snapshot forces another scan.
+    seq = polls.seq;
+    release(&polls.lock);
+    r = pollscan(fds, n);
+    acquire(&polls.lock);
+    if(r > 0 || p->killed || (timeout >= 0 && ticks - t0 >= timeout))
+      break;
+    if(polls.seq == seq)
+      sleep(&polls, &polls.lock);
+  }
+  polls.npoll--;
+  if(timeout > 0)
+    polls.ntimed--;
+  release(&polls.lock);
+
+  if(r == 0 && p->killed)
+    return -1;
+  if(copyout(p->pagetable, addr, (char*)fds, n * sizeof(fds[0])) < 0)
+    return -1;
+  return r;
+}
@@ -0,0 +1,12 @@
+// poll() events and results
+#define POLLIN    0x001  // data to read, or end of file
+#define POLLOUT   0x004  // room to write
+#define POLLERR   0x008  // write end of a pipe with no reader
+#define POLLHUP   0x010  // pipe has no writer
+#define POLLNVAL  0x020  // fd not open, or not pollable
+
+struct pollfd {
+  int fd;
+  short events;   // requested
+  short revents;  // returned
+};
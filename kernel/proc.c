@@ -3,8 +3,10 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "defs.h"
+#include "trace.h"
 
 struct cpu cpus[NCPU];
 
@@ -13,7 +15,7 @@ struct proc proc[NPROC];
 struct proc *initproc;
 
 int nextpid = 1;
-struct spinlock pid_lock;
+struct spinlock pid_lock __attribute__ ((aligned (CACHELINE)));
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
@@ -24,7 +26,7 @@ extern char trampoline[]; // trampoline.S
 // parents are not lost. helps obey the
 // memory model when using p->parent.
 // must be acquired before any p->lock.
-struct spinlock wait_lock;
+struct spinlock wait_lock __attribute__ ((aligned (CACHELINE)));
 
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
@@ -119,6 +121,9 @@ allocproc(void)
 found:
   p->pid = allocpid();
   p->state = USED;
+  memset(&p->ru, 0, sizeof(p->ru));
+  memset(&p->cru, 0, sizeof(p->cru));
+  memset(&p->cyc, 0, sizeof(p->cyc));
 
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -127,6 +132,15 @@ found:
     return 0;
   }
 
+  // Allocate the page user space can read at USYSCALL.
+  if((p->usyscall = (struct usyscall *)kalloc()) == 0){
+    freeproc(p);
+    release(&p->lock);
+    return 0;
+  }
+  memset(p->usyscall, 0, PGSIZE);
+  p->usyscall->pid = p->pid;
+
   // An empty user page table.
   p->pagetable = proc_pagetable(p);
   if(p->pagetable == 0){
@@ -153,8 +167,13 @@ freeproc(struct proc *p)
   if(p->trapframe)
     kfree((void*)p->trapframe);
   p->trapframe = 0;
-  if(p->pagetable)
+  if(p->usyscall)
+    kfree((void*)p->usyscall);
+  p->usyscall = 0;
+  if(p->pagetable){
+    ringfree(p, p->pagetable);
     proc_freepagetable(p->pagetable, p->sz);
+  }
   p->pagetable = 0;
   p->sz = 0;
   p->pid = 0;
@@ -163,6 +182,7 @@ freeproc(struct proc *p)
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  p->tracemask = 0;
   p->state = UNUSED;
 }
 
@@ -196,6 +216,24 @@ proc_pagetable(struct proc *p)
     return 0;
   }
 
+  // map the read-only pages user space can use in place
+  // of getpid() and uptime() system calls.
+  if(mappages(pagetable, USYSCALL, PGSIZE,
+              (uint64)(p->usyscall), PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+  if(mappages(pagetable, UCLOCK, PGSIZE,
+              (uint64)uclock, PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, USYSCALL, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
   return pagetable;
 }
 
@@ -206,6 +244,8 @@ proc_freepagetable(pagetable_t pagetable, uint64 sz)
 {
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
   uvmunmap(pagetable, TRAPFRAME, 1, 0);
+  uvmunmap(pagetable, USYSCALL, 1, 0);
+  uvmunmap(pagetable, UCLOCK, 1, 0);
   uvmfree(pagetable, sz);
 }
 
@@ -303,6 +343,8 @@ fork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  np->tracemask = p->tracemask;
+
   pid = np->pid;
 
   release(&np->lock);
@@ -344,6 +386,9 @@ exit(int status)
   if(p == initproc)
     panic("init exiting");
 
+  // A call this process received gets no reply now.
+  ipcabandon();
+
   // Close all open files.
   for(int fd = 0; fd < NOFILE; fd++){
     if(p->ofile[fd]){
@@ -378,14 +423,33 @@ exit(int status)
   panic("zombie exit");
 }
 
+// Add the counts in r to those in sum.
+static void
+ruadd(struct rusage *sum, struct rusage *r)
+{
+  sum->utime += r->utime;
+  sum->stime += r->stime;
+  sum->nvcsw += r->nvcsw;
+  sum->nivcsw += r->nivcsw;
+  sum->nfault += r->nfault;
+  sum->nsyscall += r->nsyscall;
+  sum->inblock += r->inblock;
+  sum->oublock += r->oublock;
+}
+
 // Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
+// If pid > 0, wait only for that child. If ruaddr != 0, copy
+// out the child's resource usage, including that of its own
+// waited-for children; either way it is added to ours.
+// Return -1 if this process has no such children, or 0 if
+// options has WNOHANG and none has exited yet.
 int
-wait(uint64 addr)
+wait4(int pid, uint64 addr, int options, uint64 ruaddr)
 {
   struct proc *np;
-  int havekids, pid;
+  int havekids, xpid;
   struct proc *p = myproc();
+  struct rusage ru;
 
   acquire(&wait_lock);
 
@@ -393,24 +457,29 @@ wait(uint64 addr)
     // Scan through table looking for exited children.
     havekids = 0;
     for(np = proc; np < &proc[NPROC]; np++){
-      if(np->parent == p){
+      if(np->parent == p && (pid <= 0 || np->pid == pid)){
         // make sure the child isn't still in exit() or swtch().
         acquire(&np->lock);
 
         havekids = 1;
         if(np->state == ZOMBIE){
           // Found one.
-          pid = np->pid;
-          if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
-                                  sizeof(np->xstate)) < 0) {
+          xpid = np->pid;
+          ru = np->ru;
+          ruadd(&ru, &np->cru);
+          if((addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
+                                   sizeof(np->xstate)) < 0) ||
+             (ruaddr != 0 && copyout(p->pagetable, ruaddr, (char *)&ru,
+                                     sizeof(ru)) < 0)) {
             release(&np->lock);
             release(&wait_lock);
             return -1;
           }
+          ruadd(&p->cru, &ru);
           freeproc(np);
           release(&np->lock);
           release(&wait_lock);
-          return pid;
+          return xpid;
         }
         release(&np->lock);
       }
@@ -421,12 +490,41 @@ wait(uint64 addr)
       release(&wait_lock);
       return -1;
     }
+
+    if(options & WNOHANG){
+      release(&wait_lock);
+      return 0;
+    }
     
     // Wait for a child to exit.
     sleep(p, &wait_lock);  //DOC: wait-sleep
   }
 }
 
+// Run p on this CPU if it is RUNNABLE.
+static void
+runproc(struct cpu *c, struct proc *p)
+{
+  acquire(&p->lock);
+  if(p->state == RUNNABLE) {
+    // Switch to chosen process.  It is the process's job
+    // to release its lock and then reacquire it
+    // before jumping back to us.
+    p->state = RUNNING;
+    c->proc = p;
+    p->cyc0 = r_cycle();
+    p->ins0 = r_instret();
+    TRACE(EV_SWITCH, p->pid, 0);
+    swtch(&c->context, &p->context);
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    c->proc = 0;
+    TRACE(EV_SWITCH, 0, 0);
+  }
+  release(&p->lock);
+}
+
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
@@ -437,29 +535,24 @@ wait(uint64 addr)
 void
 scheduler(void)
 {
-  struct proc *p;
+  struct proc *p, *np;
   struct cpu *c = mycpu();
   
   c->proc = 0;
+  c->handoff = 0;
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
     for(p = proc; p < &proc[NPROC]; p++) {
-      acquire(&p->lock);
-      if(p->state == RUNNABLE) {
-        // Switch to chosen process.  It is the process's job
-        // to release its lock and then reacquire it
-        // before jumping back to us.
-        p->state = RUNNING;
-        c->proc = p;
-        swtch(&c->context, &p->context);
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
+      runproc(c, p);
+
+      // a process that went to sleep after waking a partner
+      // with handoff() gets that partner run right away.
+      while((np = c->handoff) != 0){
+        c->handoff = 0;
+        runproc(c, np);
       }
-      release(&p->lock);
     }
   }
 }
@@ -486,11 +579,38 @@ sched(void)
   if(intr_get())
     panic("sched interruptible");
 
+  if(p->state == RUNNABLE)
+    p->ru.nivcsw++;
+  else if(p->state == SLEEPING)
+    p->ru.nvcsw++;
+
+  cycacct(p, 0);
   intena = mycpu()->intena;
   swtch(&p->context, &mycpu()->context);
   mycpu()->intena = intena;
 }
 
+// Charge the cycles and instructions since p's last
+// boundary (trap entry or exit, or being switched in)
+// to its user or kernel totals. The counters are per
+// hart, so this must run before p can move to another.
+void
+cycacct(struct proc *p, int user)
+{
+  uint64 cyc = r_cycle();
+  uint64 ins = r_instret();
+
+  if(user){
+    p->cyc.ucycles += cyc - p->cyc0;
+    p->cyc.uinstret += ins - p->ins0;
+  } else {
+    p->cyc.kcycles += cyc - p->cyc0;
+    p->cyc.kinstret += ins - p->ins0;
+  }
+  p->cyc0 = cyc;
+  p->ins0 = ins;
+}
+
 // Give up the CPU for one scheduling round.
 void
 yield(void)
@@ -543,6 +663,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  TRACE(EV_SLEEP, (uint64)chan, 0);
 
   sched();
 
@@ -566,12 +687,31 @@ wakeup(void *chan)
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
         p->state = RUNNABLE;
+        TRACE(EV_WAKEUP, (uint64)chan, p->pid);
       }
       release(&p->lock);
     }
   }
 }
 
+// Wake p if it is sleeping on chan, and ask this CPU's
+// scheduler to run it next instead of scanning the proc
+// table, so a synchronous partner (see ipc.c) runs as soon
+// as the caller blocks. The caller must be holding a
+// spinlock until it sleeps, which keeps it on this CPU.
+// Must be called without any p->lock.
+void
+handoff(struct proc *p, void *chan)
+{
+  acquire(&p->lock);
+  if(p->state == SLEEPING && p->chan == chan) {
+    p->state = RUNNABLE;
+    mycpu()->handoff = p;
+    TRACE(EV_WAKEUP, (uint64)chan, p->pid);
+  }
+  release(&p->lock);
+}
+
 // Kill the process with the given pid.
 // The victim won't exit until it tries to return
 // to user space (see usertrap() in trap.c).
@@ -19,12 +19,17 @@ struct context {
 };
 
 // Per-CPU state.
+// Written constantly by its own CPU (push_off() on every
+// acquire), so each starts on a cache line of its own.
 struct cpu {
   struct proc *proc;          // The process running on this cpu, or null.
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
-};
+  struct proc *handoff;       // Run this process next, if RUNNABLE.
+  uint64 offtime;             // r_time() when noff went from 0 to 1, if lattracing.
+  uint64 offpc;               // ... and the pc that did it, see latency.c.
+} __attribute__ ((aligned (CACHELINE)));
 
 extern struct cpu cpus[NCPU];
 
@@ -82,7 +87,12 @@ struct trapframe {
 
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
-// Per-process state
+// Per-process state.
+// The fields are grouped by who writes them, each group
+// starting a new cache line: p->lock and what it guards
+// are written by every CPU's scheduler and wakeup() scans,
+// the accounting by the running process on every trap,
+// and the rest rarely.
 struct proc {
   struct spinlock lock;
 
@@ -96,13 +106,25 @@ struct proc {
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
 
+  // updated only by the process itself; read by its parent
+  // in wait() once it is a ZOMBIE.
+  struct rusage ru __attribute__ ((aligned (CACHELINE))); // Resources used by this process
+  struct rusage cru;           // ... and by its waited-for children
+  struct cycles cyc;           // Hardware counter totals
+  uint64 cyc0;                 // cycle counter at the last boundary
+  uint64 ins0;                 // instret counter at the last boundary
+
   // these are private to the process, so p->lock need not be held.
-  uint64 kstack;               // Virtual address of kernel stack
+  uint64 kstack __attribute__ ((aligned (CACHELINE))); // Virtual address of kernel stack
   uint64 sz;                   // Size of process memory (bytes)
   pagetable_t pagetable;       // User page table
   struct trapframe *trapframe; // data page for trampoline.S
+  struct usyscall *usyscall;   // read-only page at USYSCALL
+  struct uring *uring;         // rings at URING, or null
+  uint64 tracemask;            // system calls to log, see systrace.c
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
+  struct file *ipcfile;        // endpoint of a call received, not yet answered
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
-};
+} __attribute__ ((aligned (CACHELINE)));
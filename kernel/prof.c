@@ -0,0 +1,159 @@
+//
+// Sampling profiler. While profiling is set, each CPU's
+// timer interrupt records where it interrupted, with a
+// frame-pointer backtrace, into a ring for that CPU.
+// The CPU only writes its own ring, with interrupts off;
+// profctl() readers serialize with prof.lock.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+#include "prof.h"
+
+#define NPROFSAMPLE 128   // samples per CPU
+
+int profiling;
+
+struct {
+  uint head;                // next sample to read
+  uint tail;                // next sample to write
+  struct profsample s[NPROFSAMPLE];
+} profring[NCPU] __attribute__ ((aligned (CACHELINE)));
+
+struct {
+  struct spinlock lock;     // serializes readers
+} prof = { .lock.name = "prof" };
+
+// Claim the next slot in this CPU's ring, or return 0 if
+// the readers have fallen behind.
+static struct profsample*
+profslot(struct proc *p, int user)
+{
+  struct profsample *s;
+  int id = cpuid();
+  uint tail = profring[id].tail;
+
+  if(tail - __atomic_load_n(&profring[id].head, __ATOMIC_ACQUIRE) >= NPROFSAMPLE)
+    return 0;
+  s = &profring[id].s[tail % NPROFSAMPLE];
+  s->pid = p ? p->pid : 0;
+  s->cpu = id;
+  s->user = user;
+  safestrcpy(s->name, p ? p->name : "idle", sizeof(s->name));
+  return s;
+}
+
+static void
+profpublish(void)
+{
+  int id = cpuid();
+
+  __atomic_store_n(&profring[id].tail, profring[id].tail + 1, __ATOMIC_RELEASE);
+}
+
+// Sample a timer interrupt from user space. The user
+// stack is walked with copyin(), which fails harmlessly
+// on a garbage frame pointer.
+void
+profuser(struct proc *p)
+{
+  struct profsample *s;
+  uint64 fp, ra;
+  int n;
+
+  if((s = profslot(p, 1)) == 0)
+    return;
+  s->pc[0] = p->trapframe->epc;
+  fp = p->trapframe->s0;
+  for(n = 1; n < PROF_DEPTH && fp != 0; n++){
+    if(copyin(p->pagetable, (char *)&ra, fp - 8, sizeof(ra)) < 0 ||
+       copyin(p->pagetable, (char *)&fp, fp - 16, sizeof(fp)) < 0)
+      break;
+    s->pc[n] = ra;
+  }
+  s->depth = n;
+  profpublish();
+}
+
+// Sample a timer interrupt from kernel code. fp is
+// kerneltrap()'s frame pointer; the s0 saved in its frame
+// is that of the interrupted function. Kernel stacks are
+// one page, so the walk stops at the end of that page.
+void
+profkernel(uint64 epc, uint64 fp)
+{
+  struct profsample *s;
+  uint64 top;
+  int n;
+
+  if((s = profslot(myproc(), 0)) == 0)
+    return;
+  s->pc[0] = epc;
+  top = PGROUNDUP(fp);
+  fp = *(uint64 *)(fp - 16);
+  for(n = 1; n < PROF_DEPTH; n++){
+    // fp-16 and fp-8 must both lie on the stack page.
+    if(fp > top || fp < top - PGSIZE + 16 || (fp & 7) != 0)
+      break;
+    s->pc[n] = *(uint64 *)(fp - 8);
+    fp = *(uint64 *)(fp - 16);
+  }
+  s->depth = n;
+  profpublish();
+}
+
+// Move up to n samples, from all CPUs, to user address addr.
+static int
+profread(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct profsample s;
+  int i, id, got;
+
+  got = 0;
+  for(id = 0; id < NCPU && got < n; id++){
+    for(i = 0; got < n; i++){
+      acquire(&prof.lock);
+      if(profring[id].head == __atomic_load_n(&profring[id].tail, __ATOMIC_ACQUIRE)){
+        release(&prof.lock);
+        break;
+      }
+      s = profring[id].s[profring[id].head % NPROFSAMPLE];
+      __atomic_store_n(&profring[id].head, profring[id].head + 1, __ATOMIC_RELEASE);
+      release(&prof.lock);
+      if(copyout(p->pagetable, addr + got*sizeof(s), (char *)&s, sizeof(s)) < 0)
+        return -1;
+      got++;
+    }
+  }
+  return got;
+}
+
+int
+profctl(int op, uint64 addr, int n)
+{
+  int id;
+
+  switch(op){
+  case PROF_START:
+    profiling = 0;
+    acquire(&prof.lock);
+    for(id = 0; id < NCPU; id++)
+      profring[id].head = profring[id].tail;
+    release(&prof.lock);
+    profiling = 1;
+    return 0;
+  case PROF_STOP:
+    profiling = 0;
+    return 0;
+  case PROF_READ:
+    return profread(addr, n);
+  }
+  return -1;
+}
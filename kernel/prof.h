@@ -0,0 +1,19 @@
+// Sampling profiler, see profctl().
+
+#define PROF_DEPTH  8   // program counters per sample
+
+// profctl(op, addr, n) operations
+#define PROF_START  0   // discard old samples and start sampling
+#define PROF_STOP   1
+#define PROF_READ   2   // move up to n samples to addr
+
+// taken on each timer interrupt on each CPU
+struct profsample {
+  int pid;              // 0 if the CPU was idle
+  short cpu;
+  short user;           // 1 if interrupted in user mode
+  int depth;            // valid entries in pc[]
+  int pad;
+  char name[16];        // process name, for finding symbols
+  uint64 pc[PROF_DEPTH];  // interrupted pc, then return addresses
+};
@@ -246,6 +246,9 @@ r_stval()
 }
 
 // Machine-mode Counter-Enable
+#define COUNTEREN_CY (1L << 0) // cycle
+#define COUNTEREN_TM (1L << 1) // time
+#define COUNTEREN_IR (1L << 2) // instret
 static inline void 
 w_mcounteren(uint64 x)
 {
@@ -260,6 +263,13 @@ r_mcounteren()
   return x;
 }
 
+// Supervisor Counter-Enable, for user mode.
+static inline void 
+w_scounteren(uint64 x)
+{
+  asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
 // machine-mode cycle counter
 static inline uint64
 r_time()
@@ -269,6 +279,24 @@ r_time()
   return x;
 }
 
+// cycles executed by this hart.
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
+// instructions retired by this hart.
+static inline uint64
+r_instret()
+{
+  uint64 x;
+  asm volatile("csrr %0, instret" : "=r" (x) );
+  return x;
+}
+
 // enable device interrupts
 static inline void
 intr_on()
@@ -323,6 +351,17 @@ r_ra()
   return x;
 }
 
+// read the frame pointer. with -fno-omit-frame-pointer,
+// a function's return address is at fp-8 and its caller's
+// frame pointer at fp-16.
+static inline uint64
+r_fp()
+{
+  uint64 x;
+  asm volatile("mv %0, s0" : "=r" (x) );
+  return x;
+}
+
 // flush the TLB.
 static inline void
 sfence_vma()
@@ -335,6 +374,8 @@ sfence_vma()
 #define PGSIZE 4096 // bytes per page
 #define PGSHIFT 12  // bits of offset within a page
 
+#define CACHELINE 64 // bytes per cache line
+
 #define PGROUNDUP(sz)  (((sz)+PGSIZE-1) & ~(PGSIZE-1))
 #define PGROUNDDOWN(a) (((a)) & ~(PGSIZE-1))
 
@@ -0,0 +1,27 @@
+// Per-process resource usage, see getrusage() and wait4().
+
+#define RUSAGE_SELF      0   // the calling process
+#define RUSAGE_CHILDREN  -1  // its waited-for descendants
+
+#define WNOHANG  1  // wait4(): return 0 instead of blocking
+
+struct rusage {
+  uint64 utime;     // clock ticks spent in user mode
+  uint64 stime;     // clock ticks spent in the kernel
+  uint64 nvcsw;     // voluntary context switches (sleep)
+  uint64 nivcsw;    // involuntary context switches (preemption)
+  uint64 nfault;    // page faults
+  uint64 nsyscall;  // system calls
+  uint64 inblock;   // file blocks read by readi()
+  uint64 oublock;   // file blocks written by writei()
+};
+
+// Hardware counter totals, see getcycles().
+struct cycles {
+  uint64 ucycles;   // cycles spent in user mode
+  uint64 kcycles;   // cycles spent in the kernel
+  uint64 uinstret;  // instructions retired in user mode
+  uint64 kinstret;  // instructions retired in the kernel
+  uint64 syscycles; // cycles spent inside system calls
+  uint64 lastsys;   // cycles of the last completed system call
+};
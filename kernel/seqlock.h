@@ -0,0 +1,43 @@
+// Sequence locks, for small records with a single writer
+// (who serializes with some other lock) and readers that
+// must never block it, including user space through the
+// UCLOCK page. The count is odd while a write is under
+// way; readers retry if it was odd or changed.
+//
+//   writer:                reader:
+//     seq_writebegin(&s);    do {
+//     ... update ...           s0 = seq_readbegin(&s);
+//     seq_writeend(&s);        ... copy ...
+//                            } while(seq_readretry(&s, s0));
+
+static inline void
+seq_writebegin(uint *seq)
+{
+  __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+  __sync_synchronize();
+}
+
+static inline void
+seq_writeend(uint *seq)
+{
+  __sync_synchronize();
+  __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+}
+
+static inline uint
+seq_readbegin(uint *seq)
+{
+  uint s;
+
+  while((s = __atomic_load_n(seq, __ATOMIC_RELAXED)) & 1)
+    ;
+  __sync_synchronize();
+  return s;
+}
+
+static inline int
+seq_readretry(uint *seq, uint s)
+{
+  __sync_synchronize();
+  return __atomic_load_n(seq, __ATOMIC_RELAXED) != s;
+}
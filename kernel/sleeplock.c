@@ -6,6 +6,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "sleeplock.h"
 
@@ -15,18 +16,69 @@ initsleeplock(struct sleeplock *lk, char *name)
   initlock(&lk->lk, "sleep lock");
   lk->name = name;
   lk->locked = 0;
+  lk->readers = 0;
+  lk->xwaiting = 0;
   lk->pid = 0;
+  lk->owner = 0;
+  addlock(&lk->prof, name, 1);
+}
+
+// Forget a sleep-lock whose memory is about to be freed.
+void
+freesleeplock(struct sleeplock *lk)
+{
+  freelock(&lk->lk);
+  dellock(&lk->prof);
+}
+
+// Called with lk->lk held while lk is held exclusively.
+// An owner that is running on another CPU is likely to
+// release lk soon (buffer and inode locks are mostly held
+// for microseconds), so spin without lk->lk until it does,
+// or until the owner sleeps or is descheduled.
+// Returns 1 if lk was released while spinning.
+static int
+spinwait(struct sleeplock *lk)
+{
+  struct proc *owner = lk->owner;
+
+  if(owner == 0 || owner == myproc() || owner->state != RUNNING)
+    return 0;
+  release(&lk->lk);
+  while(__atomic_load_n(&lk->owner, __ATOMIC_RELAXED) == owner &&
+        __atomic_load_n(&owner->state, __ATOMIC_RELAXED) == RUNNING)
+    ;
+  acquire(&lk->lk);
+  return !lk->locked;
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  int contended, slept;
+
   acquire(&lk->lk);
-  while (lk->locked) {
+  lk->prof.nacquire++;
+  contended = lk->locked || lk->readers;
+  slept = 0;
+  lk->xwaiting++;
+  while (lk->locked || lk->readers) {
+    if(lk->locked && spinwait(lk))
+      continue;
+    lk->prof.nwait++;
+    slept = 1;
     sleep(lk, &lk->lk);
   }
+  lk->xwaiting--;
+  if(contended){
+    lk->prof.ncontend++;
+    if(!slept)
+      lk->prof.nspun++;
+  }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->owner = myproc();
+  lk->prof.start = r_time();
   release(&lk->lk);
 }
 
@@ -34,12 +86,55 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  lk->prof.holdtime += r_time() - lk->prof.start;
   lk->locked = 0;
   lk->pid = 0;
+  lk->owner = 0;
   wakeup(lk);
   release(&lk->lk);
 }
 
+// Acquire lk shared with other readers.
+void
+acquiresleep_shared(struct sleeplock *lk)
+{
+  int contended, slept;
+
+  acquire(&lk->lk);
+  lk->prof.nacquire++;
+  contended = lk->locked || lk->xwaiting;
+  slept = 0;
+  while (lk->locked || lk->xwaiting) {
+    if(lk->locked && spinwait(lk))
+      continue;
+    lk->prof.nwait++;
+    slept = 1;
+    sleep(lk, &lk->lk);
+  }
+  if(contended){
+    lk->prof.ncontend++;
+    if(!slept)
+      lk->prof.nspun++;
+  }
+  if(lk->readers++ == 0)
+    lk->prof.start = r_time();
+  release(&lk->lk);
+}
+
+void
+releasesleep_shared(struct sleeplock *lk)
+{
+  acquire(&lk->lk);
+  if(lk->readers < 1)
+    panic("releasesleep_shared");
+  if(--lk->readers == 0){
+    lk->prof.holdtime += r_time() - lk->prof.start;
+    wakeup(lk);
+  }
+  release(&lk->lk);
+}
+
+// Is lk held exclusively by this process?
 int
 holdingsleep(struct sleeplock *lk)
 {
@@ -1,10 +1,19 @@
-// Long-term locks for processes
+// Long-term locks for processes.
+// Held either exclusively by one process, or shared by
+// any number of readers. Waiting writers keep new readers
+// out, so a stream of readers cannot starve them.
+// Waiters spin rather than sleep while the exclusive
+// holder is running on another CPU.
 struct sleeplock {
-  uint locked;       // Is the lock held?
+  uint locked;       // Is the lock held exclusively?
+  int readers;       // Number of shared holders
+  int xwaiting;      // Number of processes waiting for exclusive
   struct spinlock lk; // spinlock protecting this sleep lock
   
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+  struct proc *owner; // ... and its proc, for adaptive spinning
+  struct lockprof prof;
 };
 
@@ -5,32 +5,99 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "rusage.h"
 #include "proc.h"
 #include "defs.h"
+#include "lockstat.h"
+#include "latency.h"
+
+// Every initialized lock's statistics, for lockstat().
+struct {
+  struct spinlock lock;
+  struct lockprof *prof[NLOCK];
+} locks = { .lock.name = "locks" };
+
+void
+addlock(struct lockprof *lp, char *name, int sleep)
+{
+  int i;
+
+  memset(lp, 0, sizeof(*lp));
+  lp->name = name;
+  lp->sleep = sleep;
+  acquire(&locks.lock);
+  for(i = 0; i < NLOCK; i++){
+    if(locks.prof[i] == 0){
+      locks.prof[i] = lp;
+      release(&locks.lock);
+      return;
+    }
+  }
+  panic("addlock");
+}
+
+// Forget statistics whose memory is about to be freed.
+void
+dellock(struct lockprof *lp)
+{
+  int i;
+
+  acquire(&locks.lock);
+  for(i = 0; i < NLOCK; i++){
+    if(locks.prof[i] == lp){
+      locks.prof[i] = 0;
+      break;
+    }
+  }
+  release(&locks.lock);
+}
+
+// Forget a lock whose memory is about to be freed.
+void
+freelock(struct spinlock *lk)
+{
+  dellock(&lk->prof);
+}
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->ticket = 0;
+  lk->serving = 0;
   lk->cpu = 0;
+  addlock(&lk->prof, name, 0);
 }
 
 // Acquire the lock.
-// Loops (spins) until the lock is acquired.
+// Takes a ticket and spins until it is served.
 void
 acquire(struct spinlock *lk)
 {
+  uint t, ahead;
+  uint64 nwait;
+  int i;
+
   push_off(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
+  // On RISC-V, sync_fetch_and_add turns into an atomic add:
   //   a5 = 1
-  //   s1 = &lk->locked
-  //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+  //   s1 = &lk->ticket
+  //   amoadd.w.aqrl a5, a5, (s1)
+  t = __sync_fetch_and_add(&lk->ticket, 1);
+
+  // Waiting only reads lk->serving, so the line stays shared
+  // until the holder releases. Back off in proportion to the
+  // number of CPUs ahead of us, so that they are not all
+  // re-reading the line the moment it changes.
+  nwait = 0;
+  while((ahead = t - __atomic_load_n(&lk->serving, __ATOMIC_RELAXED)) != 0){
+    for(i = 0; i < 50 * ahead; i++)
+      asm volatile("nop");
+    nwait++;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +107,17 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+  lk->prof.nacquire++;
+  if(nwait){
+    lk->prof.ncontend++;
+    lk->prof.nwait += nwait;
+  }
+  lk->prof.start = r_time();
+  lk->prof.pc = (uint64)__builtin_return_address(0);
+  // blame the acquire, not push_off(), if tracing stamped it.
+  if(mycpu()->noff == 1 && mycpu()->offtime)
+    mycpu()->offpc = lk->prof.pc;
 }
 
 // Release the lock.
@@ -49,6 +127,10 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  uint64 t = r_time() - lk->prof.start;
+  lk->prof.holdtime += t;
+  if(lattracing)
+    latrecord(LAT_HOLD, lk->prof.pc, t);
   lk->cpu = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
@@ -59,14 +141,12 @@ release(struct spinlock *lk)
   // On RISC-V, this emits a fence instruction.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code doesn't use a C assignment, since the C standard
-  // implies that an assignment might be implemented with
-  // multiple store instructions.
-  // On RISC-V, sync_lock_release turns into an atomic swap:
-  //   s1 = &lk->locked
-  //   amoswap.w zero, zero, (s1)
-  __sync_lock_release(&lk->locked);
+  // Serve the next ticket, equivalent to lk->serving++.
+  // Only the holder writes lk->serving, so a plain load is
+  // fine; the store is atomic, since the C standard implies
+  // that an assignment might be implemented with multiple
+  // store instructions.
+  __atomic_store_n(&lk->serving, lk->serving + 1, __ATOMIC_RELAXED);
 
   pop_off();
 }
@@ -77,7 +157,7 @@ int
 holding(struct spinlock *lk)
 {
   int r;
-  r = (lk->locked && lk->cpu == mycpu());
+  r = (lk->ticket != lk->serving && lk->cpu == mycpu());
   return r;
 }
 
@@ -91,8 +171,13 @@ push_off(void)
   int old = intr_get();
 
   intr_off();
-  if(mycpu()->noff == 0)
+  if(mycpu()->noff == 0){
     mycpu()->intena = old;
+    if(lattracing){
+      mycpu()->offtime = r_time();
+      mycpu()->offpc = (uint64)__builtin_return_address(0);
+    }
+  }
   mycpu()->noff += 1;
 }
 
@@ -105,6 +190,81 @@ pop_off(void)
   if(c->noff < 1)
     panic("pop_off");
   c->noff -= 1;
+  // offtime is 0 unless tracing was on at the push_off().
+  if(c->noff == 0 && c->offtime){
+    if(lattracing)
+      latrecord(LAT_IRQOFF, c->offpc, r_time() - c->offtime);
+    c->offtime = 0;
+  }
   if(c->noff == 0 && c->intena)
     intr_on();
 }
+
+// Copy statistics for up to n locks to user address addr,
+// summing locks that share a name (all "proc" locks, say).
+// Returns the number of entries copied, or -1.
+int
+lockstat(uint64 addr, int n)
+{
+  struct lockstat *ls;
+  struct lockprof *lp;
+  int i, j, nls;
+
+  if(n < 0)
+    return -1;
+  if(n > PGSIZE / sizeof(*ls))
+    n = PGSIZE / sizeof(*ls);
+  if((ls = (struct lockstat *)kalloc()) == 0)
+    return -1;
+
+  nls = 0;
+  acquire(&locks.lock);
+  for(i = 0; i < NLOCK; i++){
+    if((lp = locks.prof[i]) == 0)
+      continue;
+    for(j = 0; j < nls; j++)
+      if(ls[j].sleep == lp->sleep &&
+         strncmp(ls[j].name, lp->name, sizeof(ls[j].name)) == 0)
+        break;
+    if(j == nls){
+      if(nls == n)
+        continue;
+      memset(&ls[j], 0, sizeof(ls[j]));
+      safestrcpy(ls[j].name, lp->name, sizeof(ls[j].name));
+      ls[j].sleep = lp->sleep;
+      nls++;
+    }
+    ls[j].nlock++;
+    ls[j].nacquire += lp->nacquire;
+    ls[j].ncontend += lp->ncontend;
+    ls[j].nwait += lp->nwait;
+    ls[j].nspun += lp->nspun;
+    ls[j].holdtime += lp->holdtime;
+  }
+  release(&locks.lock);
+
+  if(copyout(myproc()->pagetable, addr, (char *)ls, nls * sizeof(*ls)) < 0)
+    nls = -1;
+  kfree((char *)ls);
+  return nls;
+}
+
+// Zero every lock's counters.
+void
+lockstatreset(void)
+{
+  struct lockprof *lp;
+  int i;
+
+  acquire(&locks.lock);
+  for(i = 0; i < NLOCK; i++){
+    if((lp = locks.prof[i]) == 0)
+      continue;
+    lp->nacquire = 0;
+    lp->ncontend = 0;
+    lp->nwait = 0;
+    lp->nspun = 0;
+    lp->holdtime = 0;
+  }
+  release(&locks.lock);
+}
@@ -1,9 +1,27 @@
+// Contention statistics kept by every lock, updated
+// while holding it. See lockstat() in spinlock.c.
+struct lockprof {
+  char *name;
+  int sleep;         // part of a sleep-lock?
+  uint64 nacquire;   // acquisitions
+  uint64 ncontend;   // ... that found the lock held
+  uint64 nwait;      // spin iterations, or sleeps
+  uint64 nspun;      // contended sleep-lock waits that never slept
+  uint64 holdtime;   // r_time() units held
+  uint64 start;      // r_time() at acquisition
+  uint64 pc;         // acquire()'s caller, for latency.c
+};
+
 // Mutual exclusion lock.
+// A ticket lock: CPUs are served in the order they
+// arrived, and waiters only read the lock's line.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  uint ticket;       // Next ticket to hand out.
+  uint serving;      // Ticket now holding the lock.
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+  struct lockprof prof;
 };
 
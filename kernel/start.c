@@ -43,6 +43,11 @@ start()
   w_pmpaddr0(0x3fffffffffffffull);
   w_pmpcfg0(0xf);
 
+  // let supervisor and user mode read the cycle,
+  // time and instret counters.
+  w_mcounteren(COUNTEREN_CY | COUNTEREN_TM | COUNTEREN_IR);
+  w_scounteren(COUNTEREN_CY | COUNTEREN_TM | COUNTEREN_IR);
+
   // ask for clock interrupts.
   timerinit();
 
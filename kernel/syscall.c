@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "syscall.h"
 #include "defs.h"
@@ -104,6 +105,31 @@ extern uint64 sys_unlink(void);
 extern uint64 sys_wait(void);
 extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
+extern uint64 sys_endpoint(void);
+extern uint64 sys_ipc_call(void);
+extern uint64 sys_ipc_recv(void);
+extern uint64 sys_ipc_reply(void);
+extern uint64 sys_wait4(void);
+extern uint64 sys_getrusage(void);
+extern uint64 sys_getcycles(void);
+extern uint64 sys_lockbench(void);
+extern uint64 sys_lockstat(void);
+extern uint64 sys_ringsetup(void);
+extern uint64 sys_ringenter(void);
+extern uint64 sys_systrace(void);
+extern uint64 sys_profctl(void);
+extern uint64 sys_tracectl(void);
+extern uint64 sys_latstat(void);
+extern uint64 sys_readv(void);
+extern uint64 sys_writev(void);
+extern uint64 sys_pread(void);
+extern uint64 sys_pwrite(void);
+extern uint64 sys_poll(void);
+extern uint64 sys_fcntl(void);
+extern uint64 sys_sendfile(void);
+extern uint64 sys_splice(void);
+extern uint64 sys_vmsplice(void);
+extern uint64 sys_bcachectl(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -127,6 +153,31 @@ static uint64 (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_endpoint]  sys_endpoint,
+[SYS_ipc_call]  sys_ipc_call,
+[SYS_ipc_recv]  sys_ipc_recv,
+[SYS_ipc_reply] sys_ipc_reply,
+[SYS_wait4]     sys_wait4,
+[SYS_getrusage] sys_getrusage,
+[SYS_getcycles] sys_getcycles,
+[SYS_lockbench] sys_lockbench,
+[SYS_lockstat] sys_lockstat,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_systrace] sys_systrace,
+[SYS_profctl]  sys_profctl,
+[SYS_tracectl] sys_tracectl,
+[SYS_latstat]  sys_latstat,
+[SYS_readv]    sys_readv,
+[SYS_writev]   sys_writev,
+[SYS_pread]    sys_pread,
+[SYS_pwrite]   sys_pwrite,
+[SYS_poll]     sys_poll,
+[SYS_fcntl]    sys_fcntl,
+[SYS_sendfile] sys_sendfile,
+[SYS_splice]   sys_splice,
+[SYS_vmsplice] sys_vmsplice,
+[SYS_bcachectl] sys_bcachectl,
 };
 
 void
@@ -136,8 +187,21 @@ syscall(void)
   struct proc *p = myproc();
 
   num = p->trapframe->a7;
+  p->ru.nsyscall++;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    // count kernel cycles rather than elapsed ones, so time
+    // asleep or on another hart doesn't distort the figure.
+    cycacct(p, 0);
+    uint64 k0 = p->cyc.kcycles;
+    int tracing = systracing;
+    if(tracing)
+      traceenter(p, num);
     p->trapframe->a0 = syscalls[num]();
+    cycacct(p, 0);
+    p->cyc.lastsys = p->cyc.kcycles - k0;
+    p->cyc.syscycles += p->cyc.lastsys;
+    if(tracing)
+      traceexit(p, num);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
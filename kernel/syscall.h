@@ -20,3 +20,28 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_endpoint  22
+#define SYS_ipc_call  23
+#define SYS_ipc_recv  24
+#define SYS_ipc_reply 25
+#define SYS_wait4     26
+#define SYS_getrusage 27
+#define SYS_getcycles 28
+#define SYS_lockbench 29
+#define SYS_lockstat  30
+#define SYS_ringsetup 31
+#define SYS_ringenter 32
+#define SYS_systrace  33
+#define SYS_profctl   34
+#define SYS_tracectl  35
+#define SYS_latstat   36
+#define SYS_readv     37
+#define SYS_writev    38
+#define SYS_pread     39
+#define SYS_pwrite    40
+#define SYS_poll      41
+#define SYS_fcntl     42
+#define SYS_sendfile  43
+#define SYS_splice    44
+#define SYS_vmsplice  45
+#define SYS_bcachectl 46
@@ -10,11 +10,14 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "uring.h"
+#include "uio.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -66,6 +69,48 @@ sys_dup(void)
   return fd;
 }
 
+// fcntl(fd, cmd, arg): get or set an open file's flags,
+// shared by every fd that refers to the file.
+uint64
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &cmd) < 0 || argint(2, &arg) < 0)
+    return -1;
+  switch(cmd){
+  case F_GETFL:
+    if(f->readable && f->writable)
+      arg = O_RDWR;
+    else if(f->writable)
+      arg = O_WRONLY;
+    else
+      arg = O_RDONLY;
+    return arg | (f->nonblock ? O_NONBLOCK : 0);
+  case F_SETFL:
+    f->nonblock = (arg & O_NONBLOCK) != 0;
+    return 0;
+  case F_SETPIPE_SZ:
+  case F_GETPIPE_SZ:
+    if(f->type != FD_PIPE || (cmd == F_SETPIPE_SZ && arg <= 0))
+      return -1;
+    return pipesize(f->pipe, cmd == F_SETPIPE_SZ ? arg : 0);
+  }
+  return -1;
+}
+
+uint64
+sys_poll(void)
+{
+  int n, timeout;
+  uint64 p;
+
+  if(argaddr(0, &p) < 0 || argint(1, &n) < 0 || argint(2, &timeout) < 0)
+    return -1;
+  return poll(p, n, timeout);
+}
+
 uint64
 sys_read(void)
 {
@@ -91,6 +136,143 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
+// Fetch the iovec array that is the nth system call
+// argument, with its count as argument n+1.
+static int
+argiov(int n, struct iovec *iov, int *cnt)
+{
+  uint64 p, tot;
+  int i;
+
+  if(argaddr(n, &p) < 0 || argint(n+1, cnt) < 0)
+    return -1;
+  if(*cnt < 0 || *cnt > IOV_MAX)
+    return -1;
+  if(copyin(myproc()->pagetable, (char*)iov, p, *cnt * sizeof(struct iovec)) < 0)
+    return -1;
+  // the byte count is returned as an int.
+  tot = 0;
+  for(i = 0; i < *cnt; i++){
+    if(iov[i].iov_len > 0x7fffffff)
+      return -1;
+    tot += iov[i].iov_len;
+  }
+  if(tot > 0x7fffffff)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || argiov(1, iov, &cnt) < 0)
+    return -1;
+  return filereadv(f, iov, cnt);
+}
+
+uint64
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || argiov(1, iov, &cnt) < 0)
+    return -1;
+  return filewritev(f, iov, cnt);
+}
+
+uint64
+sys_pread(void)
+{
+  struct file *f;
+  int n, off;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0 ||
+     argint(3, &off) < 0 || off < 0)
+    return -1;
+  return filepread(f, p, n, off);
+}
+
+uint64
+sys_pwrite(void)
+{
+  struct file *f;
+  int n, off;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0 ||
+     argint(3, &off) < 0 || off < 0)
+    return -1;
+  return filepwrite(f, p, n, off);
+}
+
+// sendfile(out, in, off, n): copy up to n bytes from fd in
+// to fd out inside the kernel. If the int pointer off is
+// not 0, read in from *off and update *off, leaving in's
+// own offset alone.
+uint64
+sys_sendfile(void)
+{
+  struct file *in, *out;
+  struct proc *p = myproc();
+  uint64 offp;
+  int n, off, r;
+  uint uoff;
+
+  if(argfd(0, 0, &out) < 0 || argfd(1, 0, &in) < 0 ||
+     argaddr(2, &offp) < 0 || argint(3, &n) < 0)
+    return -1;
+  if(offp == 0)
+    return filesend(out, in, 0, n);
+
+  if(copyin(p->pagetable, (char*)&off, offp, sizeof(off)) < 0 || off < 0)
+    return -1;
+  uoff = off;
+  r = filesend(out, in, &uoff, n);
+  off = uoff;
+  if(copyout(p->pagetable, offp, (char*)&off, sizeof(off)) < 0)
+    return -1;
+  return r;
+}
+
+// splice(in, out, n): like sendfile() without an offset,
+// between a pipe and any other file.
+uint64
+sys_splice(void)
+{
+  struct file *in, *out;
+  int n;
+
+  if(argfd(0, 0, &in) < 0 || argfd(1, 0, &out) < 0 || argint(2, &n) < 0)
+    return -1;
+  if(in->type != FD_PIPE && out->type != FD_PIPE)
+    return -1;
+  return filesend(out, in, 0, n);
+}
+
+// vmsplice(fd, addr, n): give the page-aligned user memory
+// at addr to pipe fd instead of copying it; the pages moved
+// read as zeros afterwards.
+uint64
+sys_vmsplice(void)
+{
+  struct file *f;
+  int n;
+  uint64 p;
+
+  if(argfd(0, 0, &f) < 0 || argaddr(1, &p) < 0 || argint(2, &n) < 0)
+    return -1;
+  if(f->type != FD_PIPE || f->writable == 0 || n < 0)
+    return -1;
+  return pipegift(f->pipe, p, n, f->nonblock);
+}
+
 uint64
 sys_close(void)
 {
@@ -283,17 +465,13 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-uint64
-sys_open(void)
+// Open path and return a new file descriptor for it.
+static int
+openpath(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  if((n = argstr(0, path, MAXPATH)) < 0 || argint(1, &omode) < 0)
-    return -1;
 
   begin_op();
 
@@ -340,6 +518,7 @@ sys_open(void)
   f->ip = ip;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->nonblock = (omode & O_NONBLOCK) != 0;
 
   if((omode & O_TRUNC) && ip->type == T_FILE){
     itrunc(ip);
@@ -351,6 +530,17 @@ sys_open(void)
   return fd;
 }
 
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openpath(path, omode);
+}
+
 uint64
 sys_mkdir(void)
 {
@@ -454,16 +644,15 @@ sys_exec(void)
   return -1;
 }
 
-uint64
-sys_pipe(void)
+// Create a pipe and store its two descriptors at the
+// user address fdarray.
+static int
+pipefds(uint64 fdarray)
 {
-  uint64 fdarray; // user pointer to array of two integers
   struct file *rf, *wf;
   int fd0, fd1;
   struct proc *p = myproc();
 
-  if(argaddr(0, &fdarray) < 0)
-    return -1;
   if(pipealloc(&rf, &wf) < 0)
     return -1;
   fd0 = -1;
@@ -484,3 +673,127 @@ sys_pipe(void)
   }
   return 0;
 }
+
+uint64
+sys_pipe(void)
+{
+  uint64 fdarray; // user pointer to array of two integers
+
+  if(argaddr(0, &fdarray) < 0)
+    return -1;
+  return pipefds(fdarray);
+}
+
+// Carry out one operation from a process's submission
+// ring (see uring.c), with the same checks and result
+// as the corresponding system call.
+int
+ringop(struct sqe *e)
+{
+  char path[MAXPATH];
+  struct file *f;
+  struct proc *p = myproc();
+
+  switch(e->op){
+  case URING_NOP:
+    return 0;
+  case URING_OPEN:
+    if(fetchstr(e->addr, path, MAXPATH) < 0)
+      return -1;
+    return openpath(path, e->n);
+  case URING_PIPE:
+    return pipefds(e->addr);
+  }
+
+  if(e->fd < 0 || e->fd >= NOFILE || (f = p->ofile[e->fd]) == 0)
+    return -1;
+  switch(e->op){
+  case URING_READ:
+    return fileread(f, e->addr, e->n);
+  case URING_WRITE:
+    return filewrite(f, e->addr, e->n);
+  case URING_CLOSE:
+    p->ofile[e->fd] = 0;
+    fileclose(f);
+    return 0;
+  case URING_FSTAT:
+    return filestat(f, e->addr);
+  }
+  return -1;
+}
+
+uint64
+sys_ringsetup(void)
+{
+  return ringsetup();
+}
+
+uint64
+sys_ringenter(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  return ringenter(n);
+}
+
+uint64
+sys_endpoint(void)
+{
+  struct file *f;
+  int fd;
+
+  if(endpointalloc(&f) < 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return fd;
+}
+
+// Fetch the nth argument as an endpoint file descriptor.
+static int
+argendpoint(int n, struct file **pf)
+{
+  struct file *f;
+
+  if(argfd(n, 0, &f) < 0 || f->type != FD_ENDPOINT)
+    return -1;
+  *pf = f;
+  return 0;
+}
+
+uint64
+sys_ipc_call(void)
+{
+  struct file *f;
+  uint64 msg; // user pointer to struct ipcmsg
+
+  if(argendpoint(0, &f) < 0 || argaddr(1, &msg) < 0)
+    return -1;
+  return ipccall(f->endpoint, msg);
+}
+
+uint64
+sys_ipc_recv(void)
+{
+  struct file *f;
+  uint64 msg;
+
+  if(argendpoint(0, &f) < 0 || argaddr(1, &msg) < 0)
+    return -1;
+  return ipcrecv(f, msg);
+}
+
+uint64
+sys_ipc_reply(void)
+{
+  struct file *f;
+  uint64 msg;
+
+  if(argendpoint(0, &f) < 0 || argaddr(1, &msg) < 0)
+    return -1;
+  return ipcreply(f->endpoint, msg);
+}
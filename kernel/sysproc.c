@@ -5,7 +5,10 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
+#include "lockstat.h"
+#include "seqlock.h"
 
 uint64
 sys_exit(void)
@@ -35,7 +38,40 @@ sys_wait(void)
   uint64 p;
   if(argaddr(0, &p) < 0)
     return -1;
-  return wait(p);
+  return wait4(-1, p, 0, 0);
+}
+
+uint64
+sys_wait4(void)
+{
+  int pid, options;
+  uint64 p, ru;
+
+  if(argint(0, &pid) < 0 || argaddr(1, &p) < 0 ||
+     argint(2, &options) < 0 || argaddr(3, &ru) < 0)
+    return -1;
+  return wait4(pid, p, options, ru);
+}
+
+uint64
+sys_getrusage(void)
+{
+  int who;
+  uint64 addr; // user pointer to struct rusage
+  struct proc *p = myproc();
+  struct rusage ru;
+
+  if(argint(0, &who) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if(who == RUSAGE_SELF)
+    ru = p->ru;
+  else if(who == RUSAGE_CHILDREN)
+    ru = p->cru;
+  else
+    return -1;
+  if(copyout(p->pagetable, addr, (char *)&ru, sizeof(ru)) < 0)
+    return -1;
+  return 0;
 }
 
 uint64
@@ -83,15 +119,155 @@ sys_kill(void)
   return kill(pid);
 }
 
+uint64
+sys_getcycles(void)
+{
+  uint64 addr; // user pointer to struct cycles
+  struct proc *p = myproc();
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  cycacct(p, 0);
+  if(copyout(p->pagetable, addr, (char *)&p->cyc, sizeof(p->cyc)) < 0)
+    return -1;
+  return 0;
+}
+
+// Lock microbenchmark: wait until time start, then
+// acquire and release a shared spinlock until time end.
+// Returns the number of acquisitions this process made,
+// or -1 if killed. It spins without yielding the CPU, so
+// end may be at most LOCKBENCHMAX from now.
+#define LOCKBENCHMAX (2*TIMEBASE)
+
+struct {
+  struct spinlock lock;
+  uint64 n;
+} bench __attribute__ ((aligned (CACHELINE))) = { .lock.name = "bench" };
+
+uint64
+sys_lockbench(void)
+{
+  struct proc *p = myproc();
+  uint64 start, end, n;
+  int i;
+
+  if(argaddr(0, &start) < 0 || argaddr(1, &end) < 0)
+    return -1;
+  if(start > end || end > r_time() + LOCKBENCHMAX)
+    return -1;
+
+  while(r_time() < start)
+    if(p->killed)
+      return -1;
+  n = 0;
+  while(r_time() < end){
+    if(p->killed)
+      return -1;
+    acquire(&bench.lock);
+    bench.n++;
+    release(&bench.lock);
+    n++;
+    for(i = 0; i < 100; i++)
+      asm volatile("nop");
+  }
+  return n;
+}
+
+// lockstat(op, buf, n): read or reset lock statistics.
+uint64
+sys_lockstat(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  switch(op){
+  case LOCKSTAT_READ:
+    return lockstat(addr, n);
+  case LOCKSTAT_RESET:
+    lockstatreset();
+    return 0;
+  }
+  return -1;
+}
+
+// systrace(op, addr, n): control system call statistics
+// and tracing, see systrace.h.
+uint64
+sys_systrace(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return systrace(op, addr, n);
+}
+
+// profctl(op, addr, n): control the sampling profiler,
+// see prof.h.
+uint64
+sys_profctl(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return profctl(op, addr, n);
+}
+
+// tracectl(op, addr, n): control kernel event tracing,
+// see trace.h.
+uint64
+sys_tracectl(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return tracectl(op, addr, n);
+}
+
+// latstat(op, addr, n): control interrupts-off and
+// lock-hold latency tracking, see latency.h.
+uint64
+sys_latstat(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return latstat(op, addr, n);
+}
+
+// bcachectl(op, addr, n): buffer cache statistics and
+// size cap, see bcache.h.
+uint64
+sys_bcachectl(void)
+{
+  int op, n;
+  uint64 addr;
+
+  if(argint(0, &op) < 0 || argaddr(1, &addr) < 0 || argint(2, &n) < 0)
+    return -1;
+  return bcachectl(op, addr, n);
+}
+
 // return how many clock tick interrupts have occurred
 // since start.
 uint64
 sys_uptime(void)
 {
-  uint xticks;
+  uint xticks, s;
 
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
+  do {
+    s = seq_readbegin(&uclock->seq);
+    xticks = uclock->ticks;
+  } while(seq_readretry(&uclock->seq, s));
   return xticks;
 }
@@ -0,0 +1,155 @@
+//
+// System call statistics and tracing.
+// syscall() tests systracing once per call and only
+// calls in here when it is set, so that tracing costs one
+// predictable branch when off.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+#include "systrace.h"
+
+#define NTRACE 256  // records in the trace log
+
+int systracing;     // SYSTRACE_* bits
+
+// Per-CPU statistics, so counting needs no lock and does
+// not bounce cache lines between harts.
+struct {
+  struct sysstat s[NSYSCALL];
+} sysstats[NCPU] __attribute__ ((aligned (CACHELINE)));
+
+// Trace log, shared by all CPUs. When it is full the
+// oldest records are overwritten.
+struct {
+  struct spinlock lock;
+  uint head;        // oldest record
+  uint tail;        // next to write
+  struct tracerec rec[NTRACE];
+} tlog = { .lock.name = "systrace" };
+
+static void
+tracelog(struct proc *p, int num, int exit, uint64 a0, uint64 a1, uint64 a2)
+{
+  struct tracerec *r;
+
+  acquire(&tlog.lock);
+  if(tlog.tail - tlog.head == NTRACE)
+    tlog.head++;
+  r = &tlog.rec[tlog.tail++ % NTRACE];
+  r->pid = p->pid;
+  r->num = num;
+  r->exit = exit;
+  r->val[0] = a0;
+  r->val[1] = a1;
+  r->val[2] = a2;
+  r->time = r_time();
+  release(&tlog.lock);
+}
+
+// Called before system call num is carried out.
+void
+traceenter(struct proc *p, int num)
+{
+  if((systracing & SYSTRACE_LOG) && (p->tracemask & (1L << num)))
+    tracelog(p, num, 0, p->trapframe->a0, p->trapframe->a1, p->trapframe->a2);
+}
+
+// Called after system call num returned, with its cost in
+// kernel cycles in p->cyc.lastsys.
+void
+traceexit(struct proc *p, int num)
+{
+  struct sysstat *s;
+  uint64 c;
+  int b;
+
+  if(systracing & SYSTRACE_STATS){
+    push_off();
+    s = &sysstats[cpuid()].s[num];
+    s->count++;
+    s->cycles += p->cyc.lastsys;
+    for(b = 0, c = p->cyc.lastsys; c > 1 && b < NSYSHIST-1; c >>= 1)
+      b++;
+    s->hist[b]++;
+    pop_off();
+  }
+  if((systracing & SYSTRACE_LOG) && (p->tracemask & (1L << num)))
+    tracelog(p, num, 1, p->trapframe->a0, 0, 0);
+}
+
+// Copy the statistics for the first n system calls,
+// summed over all CPUs, to user address addr.
+static int
+statsread(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct sysstat sum;
+  int i, c, b;
+
+  if(n > NSYSCALL)
+    n = NSYSCALL;
+  for(i = 0; i < n; i++){
+    memset(&sum, 0, sizeof(sum));
+    for(c = 0; c < NCPU; c++){
+      sum.count += sysstats[c].s[i].count;
+      sum.cycles += sysstats[c].s[i].cycles;
+      for(b = 0; b < NSYSHIST; b++)
+        sum.hist[b] += sysstats[c].s[i].hist[b];
+    }
+    if(copyout(p->pagetable, addr + i*sizeof(sum), (char *)&sum, sizeof(sum)) < 0)
+      return -1;
+  }
+  return n;
+}
+
+// Move up to n records from the trace log to user address
+// addr. Records are copied one at a time, since copyout()
+// can't be called holding tlog.lock.
+static int
+logread(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct tracerec r;
+  int i;
+
+  for(i = 0; i < n; i++){
+    acquire(&tlog.lock);
+    if(tlog.head == tlog.tail){
+      release(&tlog.lock);
+      break;
+    }
+    r = tlog.rec[tlog.head++ % NTRACE];
+    release(&tlog.lock);
+    if(copyout(p->pagetable, addr + i*sizeof(r), (char *)&r, sizeof(r)) < 0)
+      return -1;
+  }
+  return i;
+}
+
+int
+systrace(int op, uint64 addr, int n)
+{
+  switch(op){
+  case SYSTRACE_CTL:
+    systracing = n;
+    return 0;
+  case SYSTRACE_MASK:
+    myproc()->tracemask = addr;
+    return 0;
+  case SYSTRACE_STATS_READ:
+    return statsread(addr, n);
+  case SYSTRACE_RESET:
+    memset(sysstats, 0, sizeof(sysstats));
+    return 0;
+  case SYSTRACE_LOG_READ:
+    return logread(addr, n);
+  }
+  return -1;
+}
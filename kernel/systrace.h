@@ -0,0 +1,29 @@
+// System call statistics and tracing, see systrace().
+
+#define NSYSCALL   64   // entries in per-call tables, > largest SYS_ number
+#define NSYSHIST   24   // latency buckets: [2^i, 2^(i+1)) cycles
+
+// bits in the global enable word
+#define SYSTRACE_STATS  1   // count calls and latency per CPU
+#define SYSTRACE_LOG    2   // log calls in each process's trace mask
+
+// systrace(op, addr, n) operations
+#define SYSTRACE_CTL    0   // set the enable word to n
+#define SYSTRACE_MASK   1   // set the calling process's trace mask to addr
+#define SYSTRACE_STATS_READ 2 // copy n struct sysstat, summed over CPUs, to addr
+#define SYSTRACE_RESET  3   // zero the statistics
+#define SYSTRACE_LOG_READ 4 // move up to n struct tracerec from the log to addr
+
+struct sysstat {
+  uint64 count;             // calls
+  uint64 cycles;            // kernel cycles in them
+  uint64 hist[NSYSHIST];    // calls by log2 of their cycles
+};
+
+struct tracerec {
+  int pid;
+  short num;                // SYS_ number
+  short exit;               // 0 for entry, 1 for return
+  uint64 val[3];            // arguments a0-a2, or return value in val[0]
+  uint64 time;              // rdtime
+};
@@ -0,0 +1,118 @@
+//
+// Kernel event tracing. Tracepoints (the TRACE() macro in
+// defs.h) append timestamped records to a ring owned by
+// the current CPU. Appending takes no lock: the CPU only
+// writes its own ring, with interrupts off, and publishes
+// each record by advancing the tail. tracectl() readers
+// serialize among themselves with trace.lock.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "defs.h"
+#include "trace.h"
+
+#define NTRACEEV 512   // events per CPU
+
+int evtracing;
+
+struct {
+  uint head;           // next event to read
+  uint tail;           // next event to write
+  uint dropped;        // events lost because the ring was full
+  struct traceev ev[NTRACEEV];
+} evring[NCPU] __attribute__ ((aligned (CACHELINE)));
+
+struct {
+  struct spinlock lock;  // serializes readers
+} trace = { .lock.name = "trace" };
+
+void
+tracepoint(int type, uint64 a0, uint64 a1)
+{
+  struct traceev *e;
+  struct proc *p;
+  uint tail;
+  int id;
+
+  push_off();
+  id = cpuid();
+  tail = evring[id].tail;
+  if(tail - __atomic_load_n(&evring[id].head, __ATOMIC_ACQUIRE) >= NTRACEEV){
+    evring[id].dropped++;
+    pop_off();
+    return;
+  }
+  p = mycpu()->proc;
+  e = &evring[id].ev[tail % NTRACEEV];
+  e->time = r_time();
+  e->type = type;
+  e->cpu = id;
+  e->pid = p ? p->pid : 0;
+  e->a0 = a0;
+  e->a1 = a1;
+  __atomic_store_n(&evring[id].tail, tail + 1, __ATOMIC_RELEASE);
+  pop_off();
+}
+
+// Move up to n events, CPU by CPU, to user address addr.
+static int
+traceread(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct traceev e;
+  int id, got;
+
+  got = 0;
+  for(id = 0; id < NCPU && got < n; id++){
+    while(got < n){
+      acquire(&trace.lock);
+      if(evring[id].head == __atomic_load_n(&evring[id].tail, __ATOMIC_ACQUIRE)){
+        release(&trace.lock);
+        break;
+      }
+      e = evring[id].ev[evring[id].head % NTRACEEV];
+      __atomic_store_n(&evring[id].head, evring[id].head + 1, __ATOMIC_RELEASE);
+      release(&trace.lock);
+      if(copyout(p->pagetable, addr + got*sizeof(e), (char *)&e, sizeof(e)) < 0)
+        return -1;
+      got++;
+    }
+  }
+  return got;
+}
+
+int
+tracectl(int op, uint64 addr, int n)
+{
+  int id, dropped;
+
+  switch(op){
+  case TRACE_START:
+    evtracing = 0;
+    acquire(&trace.lock);
+    for(id = 0; id < NCPU; id++){
+      evring[id].head = evring[id].tail;
+      evring[id].dropped = 0;
+    }
+    release(&trace.lock);
+    evtracing = 1;
+    return 0;
+  case TRACE_STOP:
+    evtracing = 0;
+    return 0;
+  case TRACE_READ:
+    return traceread(addr, n);
+  case TRACE_DROPPED:
+    dropped = 0;
+    for(id = 0; id < NCPU; id++)
+      dropped += __atomic_load_n(&evring[id].dropped, __ATOMIC_RELAXED);
+    return dropped;
+  }
+  return -1;
+}
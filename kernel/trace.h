@@ -0,0 +1,35 @@
+// Kernel event tracing, see tracectl().
+
+// event types, and what a0 and a1 hold
+#define EV_SWITCH     1   // this CPU now runs pid a0 (0: the scheduler)
+#define EV_SLEEP      2   // sleep on chan a0
+#define EV_WAKEUP     3   // wake pid a1, asleep on chan a0
+#define EV_BREAD_HIT  4   // block a0 found in the buffer cache
+#define EV_BREAD_MISS 5   // block a0 must be read from disk
+#define EV_DISK_START 6   // disk request for block a0, a1 = write?
+#define EV_DISK_DONE  7   // disk request for block a0 completed
+#define EV_BEGIN_OP   8   // begin_op() entered
+#define EV_BEGIN_OK   9   // ... returned, with a0 ops outstanding
+#define EV_COMMIT     10  // commit phase a0, with a1 blocks in the log
+#define EV_FAULT      11  // user fault, scause a0, stval a1
+
+// commit phases
+#define COMMIT_START   0
+#define COMMIT_LOGGED  1  // blocks written to the log
+#define COMMIT_HEAD    2  // header written: the commit point
+#define COMMIT_INSTALL 3  // blocks installed at home locations
+#define COMMIT_DONE    4  // log cleared
+
+// tracectl(op, addr, n) operations
+#define TRACE_START   0   // discard old events and start tracing
+#define TRACE_STOP    1
+#define TRACE_READ    2   // move up to n events to addr
+#define TRACE_DROPPED 3   // events lost to full rings since TRACE_START
+
+struct traceev {
+  uint64 time;            // rdtime
+  short type;             // EV_*
+  short cpu;
+  int pid;                // current process, or 0
+  uint64 a0, a1;
+};
@@ -3,12 +3,21 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rusage.h"
 #include "proc.h"
 #include "defs.h"
+#include "trace.h"
+#include "seqlock.h"
 
-struct spinlock tickslock;
+// on a line of their own: every sleep() reads them, and
+// hart 0 writes them on every clock tick.
+struct spinlock tickslock __attribute__ ((aligned (CACHELINE)));
 uint ticks;
 
+// ticks as published to uptime() and user space, which
+// read it without taking tickslock.
+struct uclock *uclock;
+
 extern char trampoline[], uservec[], userret[];
 
 // in kernelvec.S, calls kerneltrap().
@@ -20,6 +29,10 @@ void
 trapinit(void)
 {
   initlock(&tickslock, "time");
+  if((uclock = (struct uclock *)kalloc()) == 0)
+    panic("trapinit");
+  memset(uclock, 0, PGSIZE);
+  uclock->freq = TIMEBASE;
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -46,6 +59,7 @@ usertrap(void)
   w_stvec((uint64)kernelvec);
 
   struct proc *p = myproc();
+  cycacct(p, 1);
   
   // save user program counter.
   p->trapframe->epc = r_sepc();
@@ -68,6 +82,10 @@ usertrap(void)
   } else if((which_dev = devintr()) != 0){
     // ok
   } else {
+    if(r_scause() == 12 || r_scause() == 13 || r_scause() == 15){
+      p->ru.nfault++;
+      TRACE(EV_FAULT, r_scause(), r_stval());
+    }
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
     printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
     p->killed = 1;
@@ -76,9 +94,14 @@ usertrap(void)
   if(p->killed)
     exit(-1);
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2)
+  // charge the tick to user time, and give up
+  // the CPU if this is a timer interrupt.
+  if(which_dev == 2){
+    if(profiling)
+      profuser(p);
+    p->ru.utime++;
     yield();
+  }
 
   usertrapret();
 }
@@ -96,6 +119,9 @@ usertrapret(void)
   // we're back in user space, where usertrap() is correct.
   intr_off();
 
+  // from here on the cycles are the user's.
+  cycacct(p, 0);
+
   // send syscalls, interrupts, and exceptions to trampoline.S
   w_stvec(TRAMPOLINE + (uservec - trampoline));
 
@@ -149,9 +175,15 @@ kerneltrap()
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
+  if(which_dev == 2 && profiling)
+    profkernel(sepc, r_fp());
+
+  // charge the tick to the interrupted process's kernel
+  // time, and give up the CPU if this is a timer interrupt.
+  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING){
+    myproc()->ru.stime++;
     yield();
+  }
 
   // the yield() may have caused some traps to occur,
   // so restore trap registers for use by kernelvec.S's sepc instruction.
@@ -164,8 +196,13 @@ clockintr()
 {
   acquire(&tickslock);
   ticks++;
+  seq_writebegin(&uclock->seq);
+  uclock->ticks = ticks;
+  uclock->ticktime = r_time();
+  seq_writeend(&uclock->seq);
   wakeup(&ticks);
   release(&tickslock);
+  polltick();
 }
 
 // check if it's an external interrupt or software interrupt,
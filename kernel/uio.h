@@ -0,0 +1,7 @@
+// Scatter/gather buffers for readv() and writev().
+#define IOV_MAX 16   // most iovecs per call
+
+struct iovec {
+  void *iov_base;    // user address
+  uint64 iov_len;    // bytes
+};
@@ -0,0 +1,86 @@
+//
+// Batched system calls through rings shared with user
+// space. See uring.h for the layout. The kernel has no
+// threads of its own, so operations are carried out
+// synchronously, in order, by ringenter().
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "rusage.h"
+#include "proc.h"
+#include "uring.h"
+
+// Allocate the calling process's rings and map them at
+// URING. Returns URING, or -1.
+uint64
+ringsetup(void)
+{
+  struct proc *p = myproc();
+  struct uring *r;
+
+  if(p->uring)
+    return URING;
+  if((r = (struct uring *)kalloc()) == 0)
+    return -1;
+  memset(r, 0, PGSIZE);
+  if(mappages(p->pagetable, URING, PGSIZE, (uint64)r,
+              PTE_R | PTE_W | PTE_U) < 0){
+    kfree((char *)r);
+    return -1;
+  }
+  p->uring = r;
+  return URING;
+}
+
+// Unmap and free p's rings, if any, from pagetable,
+// on exec() or exit.
+void
+ringfree(struct proc *p, pagetable_t pagetable)
+{
+  if(p->uring == 0)
+    return;
+  uvmunmap(pagetable, URING, 1, 1);
+  p->uring = 0;
+}
+
+// Carry out up to n submitted operations, stopping early
+// if the submission ring empties or the completion ring
+// fills. Returns the number carried out, or -1.
+int
+ringenter(int n)
+{
+  struct proc *p = myproc();
+  struct uring *r = p->uring;
+  struct sqe e;
+  struct cqe *c;
+  uint head, tail;
+  int done;
+
+  if(r == 0 || n < 0)
+    return -1;
+
+  for(done = 0; done < n && !p->killed; done++){
+    head = r->sqhead;
+    if(head == __atomic_load_n(&r->sqtail, __ATOMIC_ACQUIRE))
+      break;
+    tail = r->cqtail;
+    if(tail - __atomic_load_n(&r->cqhead, __ATOMIC_ACQUIRE) >= URING_NENT)
+      break;
+
+    // copy the entry, since user code can rewrite the page
+    // at any time.
+    e = r->sq[head & (URING_NENT-1)];
+    __atomic_store_n(&r->sqhead, head + 1, __ATOMIC_RELEASE);
+
+    c = &r->cq[tail & (URING_NENT-1)];
+    c->data = e.data;
+    c->res = ringop(&e);
+    __atomic_store_n(&r->cqtail, tail + 1, __ATOMIC_RELEASE);
+  }
+  return done;
+}
@@ -0,0 +1,44 @@
+// Submission and completion rings, shared between a process
+// and the kernel in one page at URING (see memlayout.h).
+// User code fills sq[] entries and advances sqtail, then
+// calls ringenter() to have the kernel carry out a batch
+// of operations with a single trap; results show up in
+// cq[] as the kernel advances cqtail. The head and tail
+// counters run freely; index with & (URING_NENT-1).
+
+#define URING_NENT  64  // entries per ring, a power of two
+
+// operations
+#define URING_NOP    0
+#define URING_READ   1  // read(fd, addr, n)
+#define URING_WRITE  2  // write(fd, addr, n)
+#define URING_OPEN   3  // open(addr, n)
+#define URING_CLOSE  4  // close(fd)
+#define URING_FSTAT  5  // fstat(fd, addr)
+#define URING_PIPE   6  // pipe(addr)
+
+// submission queue entry
+struct sqe {
+  int op;          // URING_*
+  int fd;
+  uint64 addr;     // buffer, path, struct stat or int[2]
+  int n;           // byte count, or open mode
+  int pad;
+  uint64 data;     // copied to the completion
+};
+
+// completion queue entry
+struct cqe {
+  uint64 data;     // from the submission
+  int res;         // what the system call would return
+  int pad;
+};
+
+struct uring {
+  uint sqhead;     // next entry the kernel will consume
+  uint sqtail;     // next entry user code will fill
+  uint cqhead;     // next completion user code will consume
+  uint cqtail;     // next completion the kernel will fill
+  struct sqe sq[URING_NENT];
+  struct cqe cq[URING_NENT];
+};
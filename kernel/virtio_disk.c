@@ -16,6 +16,13 @@
 #include "fs.h"
 #include "buf.h"
 #include "virtio.h"
+#include "trace.h"
+
+// each request takes three descriptors; the buffer cache
+// counts on at most NDISKIO buffers being busy with the disk.
+#if NUM / 3 > NDISKIO
+#error "NDISKIO in param.h is too small for NUM"
+#endif
 
 // the address of virtio mmio register r.
 #define R(r) ((volatile uint32 *)(VIRTIO0 + (r)))
@@ -200,8 +207,11 @@ alloc3_desc(int *idx)
   return 0;
 }
 
+// start reading or writing b, without waiting for it.
+// the disk owns b (b->disk is 1) until virtio_disk_intr()
+// sees the request finish; a finished read makes b valid.
 void
-virtio_disk_rw(struct buf *b, int write)
+virtio_disk_submit(struct buf *b, int write)
 {
   uint64 sector = b->blockno * (BSIZE / 512);
 
@@ -255,6 +265,7 @@ virtio_disk_rw(struct buf *b, int write)
   // record struct buf for virtio_disk_intr().
   b->disk = 1;
   disk.info[idx[0]].b = b;
+  TRACE(EV_DISK_START, b->blockno, write);
 
   // tell the device the first index in our chain of descriptors.
   disk.avail->ring[disk.avail->idx % NUM] = idx[0];
@@ -268,17 +279,31 @@ virtio_disk_rw(struct buf *b, int write)
 
   *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
 
+  release(&disk.vdisk_lock);
+}
+
+// wait for the disk to finish with b, if it has it.
+void
+virtio_disk_wait(struct buf *b)
+{
+  acquire(&disk.vdisk_lock);
+
   // Wait for virtio_disk_intr() to say request has finished.
+  // requests finish in whatever order the device chooses.
   while(b->disk == 1) {
     sleep(b, &disk.vdisk_lock);
   }
 
-  disk.info[idx[0]].b = 0;
-  free_chain(idx[0]);
-
   release(&disk.vdisk_lock);
 }
 
+void
+virtio_disk_rw(struct buf *b, int write)
+{
+  virtio_disk_submit(b, write);
+  virtio_disk_wait(b);
+}
+
 void
 virtio_disk_intr()
 {
@@ -305,9 +330,22 @@ virtio_disk_intr()
       panic("virtio_disk_intr status");
 
     struct buf *b = disk.info[id].b;
+    TRACE(EV_DISK_DONE, b->blockno, 0);
+    if(disk.ops[id].type == VIRTIO_BLK_T_IN)
+      b->valid = 1;
+    if(b->iodone){
+      void (*done)(struct buf*) = b->iodone;
+      b->iodone = 0;
+      done(b);
+    }
     b->disk = 0;   // disk is done with buf
     wakeup(b);
 
+    // no one may be waiting for an asynchronous request,
+    // so its descriptors are freed here.
+    disk.info[id].b = 0;
+    free_chain(id);
+
     disk.used_idx += 1;
   }
 
@@ -97,6 +97,28 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
   return &pagetable[PX(0, va)];
 }
 
+// Replace the page mapped at user address va with the
+// physical page pa, keeping the permissions. Return the
+// old page, or 0 if va isn't a writable user page.
+uint64
+uvmswap(pagetable_t pagetable, uint64 va, uint64 pa)
+{
+  pte_t *pte;
+  uint64 old;
+  int perm;
+
+  if(va >= MAXVA || (pte = walk(pagetable, va, 0)) == 0)
+    return 0;
+  if((*pte & (PTE_V|PTE_U|PTE_W)) != (PTE_V|PTE_U|PTE_W))
+    return 0;
+  old = PTE2PA(*pte);
+  perm = PTE_FLAGS(*pte) & ~PTE_V;
+  uvmunmap(pagetable, va, 1, 0);
+  if(mappages(pagetable, va, PGSIZE, pa, perm) != 0)
+    panic("uvmswap");
+  return old;
+}
+
 // Look up a virtual address, return the physical address,
 // or 0 if not mapped.
 // Can only be used to look up user pages.
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Turn the samples printed by xv6's prof command into folded
+stacks, one "frame;frame;... count" line per distinct stack,
+as read by flamegraph.pl and speedscope.
+
+  make qemu | tee console.txt      # then run: prof cmd args
+  ./prof2folded.py console.txt > prof.folded
+  flamegraph.pl prof.folded > prof.svg
+
+Kernel pcs are looked up in kernel/kernel.sym and user pcs
+in user/_<name>.sym, both written by the Makefile. Kernel
+frames are marked with a _[k] suffix.
+"""
+
+import bisect
+import collections
+import os
+import sys
+
+TOP = os.path.dirname(os.path.abspath(__file__))
+
+
+class Symbols:
+    def __init__(self, path):
+        syms = []
+        try:
+            with open(path) as f:
+                for line in f:
+                    parts = line.split()
+                    if len(parts) != 2:
+                        continue
+                    try:
+                        syms.append((int(parts[0], 16), parts[1]))
+                    except ValueError:
+                        pass
+        except OSError:
+            pass
+        # section names and local labels are not functions.
+        syms = [s for s in syms if not s[1].startswith('.')]
+        syms.sort()
+        self.addrs = [a for a, _ in syms]
+        self.names = [n for _, n in syms]
+
+    def lookup(self, pc):
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i < 0:
+            return '0x%x' % pc
+        return self.names[i]
+
+
+_symtabs = {}
+
+
+def symbols(name):
+    if name not in _symtabs:
+        if name == 'kernel':
+            path = os.path.join(TOP, 'kernel', 'kernel.sym')
+        else:
+            path = os.path.join(TOP, 'user', '_%s.sym' % name)
+        _symtabs[name] = Symbols(path)
+    return _symtabs[name]
+
+
+def fold(lines):
+    counts = collections.Counter()
+    for line in lines:
+        i = line.find('prof: ')
+        if i < 0:
+            continue
+        fields = line[i + len('prof: '):].split()
+        if len(fields) < 4:
+            continue
+        _, name, mode = fields[:3]
+        try:
+            pcs = [int(pc, 16) for pc in fields[3:]]
+        except ValueError:
+            continue
+        if mode == 'k':
+            syms, suffix = symbols('kernel'), '_[k]'
+        else:
+            syms, suffix = symbols(name), ''
+        # pcs[0] is where the interrupt hit; the rest are
+        # return addresses, so look up the call instruction.
+        frames = [syms.lookup(pcs[0])]
+        frames += [syms.lookup(pc - 4) for pc in pcs[1:]]
+        stack = [name] + [f + suffix for f in reversed(frames)]
+        counts[';'.join(stack)] += 1
+    return counts
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit('usage: prof2folded.py [console-log]')
+    if len(sys.argv) == 2:
+        with open(sys.argv[1], errors='replace') as f:
+            counts = fold(f)
+    else:
+        counts = fold(sys.stdin)
+    for stack, n in sorted(counts.items()):
+        print('%s %d' % (stack, n))
+
+
+if __name__ == '__main__':
+    main()
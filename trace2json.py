@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Convert the events printed by xv6's ktrace command into a
+Chrome trace (JSON) that chrome://tracing and Perfetto can
+open.
+
+  make qemu | tee console.txt      # then run: ktrace cmd args
+  ./trace2json.py console.txt > trace.json
+
+Each CPU gets a track showing which process it ran, and
+each process a track with its begin_op() waits, sleeps and
+faults. Disk requests are async slices keyed by block
+number, wakeups are flow arrows from the waker to the
+woken process's next run, and commits are slices per
+phase. Event numbers match kernel/trace.h.
+"""
+
+import json
+import sys
+
+EV_SWITCH, EV_SLEEP, EV_WAKEUP, EV_BREAD_HIT, EV_BREAD_MISS, \
+    EV_DISK_START, EV_DISK_DONE, EV_BEGIN_OP, EV_BEGIN_OK, EV_COMMIT, \
+    EV_FAULT = range(1, 12)
+
+COMMIT_PHASES = ['write log', 'write head', 'install', 'clear log']
+
+TIMEBASE = 10  # rdtime ticks per microsecond under QEMU
+
+CPUS, PROCS = 1, 2  # Chrome-trace "pid"s used as track groups
+
+
+def parse(lines):
+    evs = []
+    for line in lines:
+        i = line.find('trace: ')
+        if i < 0:
+            continue
+        f = line[i + len('trace: '):].split()
+        if len(f) != 6:
+            continue
+        try:
+            evs.append((int(f[0], 16), int(f[1]), int(f[2]), int(f[3]),
+                        int(f[4], 16), int(f[5], 16)))
+        except ValueError:
+            pass
+    evs.sort()
+    return evs
+
+
+def convert(evs):
+    out = [
+        {'ph': 'M', 'pid': CPUS, 'name': 'process_name', 'args': {'name': 'CPUs'}},
+        {'ph': 'M', 'pid': PROCS, 'name': 'process_name', 'args': {'name': 'processes'}},
+    ]
+    running = {}    # cpu -> pid it is running
+    wakeflow = {}   # woken pid -> flow id
+    nflow = 0
+    if not evs:
+        return out
+    t0 = evs[0][0]
+
+    for time, cpu, pid, typ, a0, a1 in evs:
+        ts = (time - t0) / TIMEBASE
+        ev = None
+        if typ == EV_SWITCH:
+            if cpu in running:
+                out.append({'ph': 'E', 'pid': CPUS, 'tid': cpu, 'ts': ts})
+                del running[cpu]
+            if a0 != 0:
+                running[cpu] = a0
+                out.append({'ph': 'B', 'pid': CPUS, 'tid': cpu, 'ts': ts,
+                            'name': 'pid %d' % a0})
+                if a0 in wakeflow:
+                    out.append({'ph': 'f', 'bp': 'e', 'pid': CPUS, 'tid': cpu,
+                                'ts': ts, 'name': 'wakeup', 'cat': 'wakeup',
+                                'id': wakeflow.pop(a0)})
+        elif typ == EV_SLEEP:
+            ev = {'ph': 'i', 's': 't', 'name': 'sleep', 'args': {'chan': hex(a0)}}
+        elif typ == EV_WAKEUP:
+            nflow += 1
+            wakeflow[a1] = nflow
+            out.append({'ph': 's', 'pid': CPUS, 'tid': cpu, 'ts': ts,
+                        'name': 'wakeup', 'cat': 'wakeup', 'id': nflow})
+            ev = {'ph': 'i', 's': 't', 'name': 'wakeup pid %d' % a1,
+                  'args': {'chan': hex(a0)}}
+        elif typ in (EV_BREAD_HIT, EV_BREAD_MISS):
+            ev = {'ph': 'i', 's': 't',
+                  'name': 'bread hit' if typ == EV_BREAD_HIT else 'bread miss',
+                  'args': {'block': a0}}
+        elif typ == EV_DISK_START:
+            out.append({'ph': 'b', 'pid': PROCS, 'tid': 0, 'ts': ts, 'cat': 'disk',
+                        'id': a0, 'name': 'disk write' if a1 else 'disk read',
+                        'args': {'block': a0}})
+        elif typ == EV_DISK_DONE:
+            out.append({'ph': 'e', 'pid': PROCS, 'tid': 0, 'ts': ts, 'cat': 'disk',
+                        'id': a0, 'name': 'disk'})
+        elif typ == EV_BEGIN_OP:
+            ev = {'ph': 'B', 'name': 'begin_op'}
+        elif typ == EV_BEGIN_OK:
+            ev = {'ph': 'E', 'args': {'outstanding': a0}}
+        elif typ == EV_COMMIT:
+            if a0 > 0:
+                ev = {'ph': 'E'}
+                out.append(dict(ev, pid=PROCS, tid=pid, ts=ts))
+            if a0 < len(COMMIT_PHASES):
+                ev = {'ph': 'B', 'name': 'commit: ' + COMMIT_PHASES[a0],
+                      'args': {'blocks': a1}}
+            else:
+                ev = None
+        elif typ == EV_FAULT:
+            ev = {'ph': 'i', 's': 't', 'name': 'fault',
+                  'args': {'scause': a0, 'stval': hex(a1)}}
+        if ev is not None:
+            out.append(dict(ev, pid=PROCS, tid=pid, ts=ts))
+    return out
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit('usage: trace2json.py [console-log]')
+    if len(sys.argv) == 2:
+        with open(sys.argv[1], errors='replace') as f:
+            evs = parse(f)
+    else:
+        evs = parse(sys.stdin)
+    json.dump({'traceEvents': convert(evs), 'displayTimeUnit': 'ns'},
+              sys.stdout)
+    print()
+
+
+if __name__ == '__main__':
+    main()
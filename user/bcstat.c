@@ -0,0 +1,72 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/bcache.h"
+#include "user/user.h"
+
+//
+// Print buffer cache size and hit statistics. -r zeroes
+// the counters, -m sets the most buffers the cache may
+// grow to. With a command, zero the counters, run it, and
+// print the statistics for just that run:
+//   $ bcstat
+//   $ bcstat -m 100
+//   $ bcstat grep the README
+//
+
+void
+print(void)
+{
+  struct bcachestat st;
+  uint64 n;
+
+  if(bcachectl(BCACHE_STAT, &st, 0) < 0){
+    fprintf(2, "bcstat: cannot read statistics\n");
+    exit(1);
+  }
+  n = st.hits + st.misses;
+  printf("buffers %d (min %d, max %d, limit %d)\n", st.nbuf, st.minbuf, st.max, st.limit);
+  printf("hits %d misses %d", (int)st.hits, (int)st.misses);
+  if(n > 0)
+    printf(" (%d%% hits)", (int)(st.hits * 100 / n));
+  printf(", metadata hits %d\n", (int)st.metahits);
+  printf("policy %s, %d buffers on probation, %d ghost hits\n",
+    st.lru ? "lru" : "2q", st.probation, (int)st.ghosthits);
+  printf("read ahead %d blocks\n", (int)st.readahead);
+  printf("grown %d pages, reclaimed %d pages\n", (int)st.grows, (int)st.reclaims);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc > 1 && strcmp(argv[1], "-r") == 0){
+    bcachectl(BCACHE_RESET, 0, 0);
+    exit(0);
+  }
+  if(argc > 1 && strcmp(argv[1], "-m") == 0){
+    if(argc != 3 || bcachectl(BCACHE_SETMAX, 0, atoi(argv[2])) < 0){
+      fprintf(2, "usage: bcstat -m nbuf\n");
+      exit(1);
+    }
+    print();
+    exit(0);
+  }
+
+  if(argc > 1){
+    bcachectl(BCACHE_RESET, 0, 0);
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "bcstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "bcstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+  print();
+  exit(0);
+}
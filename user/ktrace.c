@@ -0,0 +1,82 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/rusage.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+
+//
+// Record kernel events while a command runs:
+//   ktrace [-o file] cmd args
+// Each event is printed as one line:
+//   trace: time cpu pid type a0 a1
+// Capture the console output (or the -o file) on the
+// host and convert it to a Chrome trace / Perfetto
+// timeline with ./trace2json.py. Events the kernel had
+// no room for are counted, and the count printed at the
+// end, on stderr.
+//
+
+struct traceev evs[16];
+
+int
+drain(int fd)
+{
+  struct traceev *e;
+  int n, i, total;
+
+  total = 0;
+  while((n = tracectl(TRACE_READ, (uint64)evs, 16)) > 0){
+    for(i = 0; i < n; i++){
+      e = &evs[i];
+      fprintf(fd, "trace: %p %d %d %d %p %p\n", e->time, e->cpu, e->pid,
+              e->type, e->a0, e->a1);
+    }
+    total += n;
+  }
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid, dropped;
+
+  fd = 1;
+  if(argc > 3 && strcmp(argv[1], "-o") == 0){
+    if((fd = open(argv[2], O_CREATE | O_WRONLY | O_TRUNC)) < 0){
+      fprintf(2, "ktrace: cannot open %s\n", argv[2]);
+      exit(1);
+    }
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: ktrace [-o file] cmd args...\n");
+    exit(1);
+  }
+
+  tracectl(TRACE_START, 0, 0);
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "ktrace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "ktrace: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  for(;;){
+    if(drain(fd) == 0){
+      if(wait4(pid, 0, WNOHANG, 0) == pid)
+        break;
+      sleep(1);
+    }
+  }
+  tracectl(TRACE_STOP, 0, 0);
+  drain(fd);
+  if((dropped = tracectl(TRACE_DROPPED, 0, 0)) > 0)
+    fprintf(2, "ktrace: %d events dropped\n", dropped);
+  exit(0);
+}
@@ -0,0 +1,73 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/latency.h"
+#include "user/user.h"
+
+//
+// Report the kernel call sites that kept interrupts off,
+// or held a spinlock, the longest while a command ran:
+//   latency [-n top] cmd args
+// Times are in microseconds. Look the pcs up in
+// kernel/kernel.asm, or with addr2line -e kernel/kernel.
+//
+
+#define NTOP 32
+#define US (TIMEBASE / 1000000)   // rdtime units per microsecond
+
+struct latsite sites[NTOP];
+
+void
+report(int op, char *what, int n)
+{
+  struct latsite *s;
+  int i;
+
+  if((n = latstat(op, (uint64)sites, n)) < 0){
+    fprintf(2, "latency: cannot read %s sites\n", what);
+    exit(1);
+  }
+  printf("%s: pc count max-us mean-us\n", what);
+  for(i = 0; i < n; i++){
+    s = &sites[i];
+    printf("%p %d %d %d\n", s->pc, (int)s->count, (int)(s->max / US),
+           (int)(s->total / s->count / US));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, n = 10;
+
+  if(argc > 3 && strcmp(argv[1], "-n") == 0){
+    n = atoi(argv[2]);
+    if(n > NTOP)
+      n = NTOP;
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: latency [-n top] cmd args...\n");
+    exit(1);
+  }
+
+  latstat(LAT_START, 0, 0);
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "latency: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "latency: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  wait(0);
+  latstat(LAT_STOP, 0, 0);
+
+  report(LAT_READ_IRQOFF, "interrupts off", n);
+  report(LAT_READ_HOLD, "spinlock held", n);
+  exit(0);
+}
@@ -0,0 +1,72 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+//
+// Spinlock microbenchmark. For 1..nproc processes, each
+// hammers one kernel spinlock for the same interval
+// (see sys_lockbench) and reports its acquisitions.
+// Prints total throughput and, for fairness, the fewest
+// and most acquisitions any one process got.
+// Run with as many processes as the kernel has CPUs:
+//   $ lockbench 8
+//
+
+#define INTERVAL 10000000   // timer units; 1 second in qemu
+
+int
+main(int argc, char *argv[])
+{
+  int nproc, n, i, fds[2];
+  uint64 start, end, cnt, total, min, max;
+
+  nproc = argc > 1 ? atoi(argv[1]) : 8;
+  if(nproc < 1){
+    fprintf(2, "usage: lockbench [nproc]\n");
+    exit(1);
+  }
+
+  for(n = 1; n <= nproc; n++){
+    if(pipe(fds) < 0){
+      fprintf(2, "lockbench: pipe failed\n");
+      exit(1);
+    }
+    // give every child time to be forked and scheduled
+    // before the interval starts.
+    start = rdtime() + INTERVAL / 10;
+    end = start + INTERVAL;
+    for(i = 0; i < n; i++){
+      int pid = fork();
+      if(pid < 0){
+        fprintf(2, "lockbench: fork failed\n");
+        exit(1);
+      }
+      if(pid == 0){
+        close(fds[0]);
+        cnt = lockbench(start, end);
+        write(fds[1], &cnt, sizeof(cnt));
+        exit(0);
+      }
+    }
+    close(fds[1]);
+    total = max = 0;
+    min = ~0ULL;
+    for(i = 0; i < n; i++){
+      if(read(fds[0], &cnt, sizeof(cnt)) != sizeof(cnt)){
+        fprintf(2, "lockbench: short read\n");
+        exit(1);
+      }
+      total += cnt;
+      if(cnt < min)
+        min = cnt;
+      if(cnt > max)
+        max = cnt;
+    }
+    close(fds[0]);
+    for(i = 0; i < n; i++)
+      wait(0);
+    printf("lockbench: %d procs %d acquires/s min %d max %d\n",
+           n, (int)total, (int)min, (int)max);
+  }
+  exit(0);
+}
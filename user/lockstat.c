@@ -0,0 +1,112 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+//
+// Print kernel lock contention statistics, most contended
+// first. With a command, zero the counters, run it, and
+// print the statistics for just that run:
+//   $ lockstat
+//   $ lockstat -r
+//   $ lockstat usertests -q
+//
+
+#define NSTAT 64
+
+struct lockstat ls[NSTAT];
+
+// print s left-justified in a field of width w.
+void
+pad(char *s, int w)
+{
+  int n = strlen(s);
+
+  printf("%s", s);
+  for(; n < w; n++)
+    printf(" ");
+}
+
+void
+padint(uint64 x, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  } while(x != 0 && i > 0);
+  for(; sizeof(buf) - 1 - i < w; w--)
+    printf(" ");
+  printf("%s", buf + i);
+}
+
+void
+print(void)
+{
+  struct lockstat t;
+  int n, i, j;
+
+  if((n = lockstat(LOCKSTAT_READ, ls, NSTAT)) < 0){
+    fprintf(2, "lockstat: cannot read statistics\n");
+    exit(1);
+  }
+
+  // sort by contended acquisitions, then acquisitions.
+  for(i = 1; i < n; i++){
+    for(j = i; j > 0; j--){
+      if(ls[j].ncontend < ls[j-1].ncontend ||
+         (ls[j].ncontend == ls[j-1].ncontend &&
+          ls[j].nacquire <= ls[j-1].nacquire))
+        break;
+      t = ls[j];
+      ls[j] = ls[j-1];
+      ls[j-1] = t;
+    }
+  }
+
+  printf("name             kind     n     acquire    contend       wait       spun       hold\n");
+  for(i = 0; i < n; i++){
+    if(ls[i].nacquire == 0)
+      continue;
+    pad(ls[i].name, 17);
+    pad(ls[i].sleep ? "sleep" : "spin", 6);
+    padint(ls[i].nlock, 4);
+    padint(ls[i].nacquire, 12);
+    padint(ls[i].ncontend, 11);
+    padint(ls[i].nwait, 11);
+    padint(ls[i].nspun, 11);
+    padint(ls[i].holdtime, 11);
+    printf("\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc > 1 && strcmp(argv[1], "-r") == 0){
+    lockstat(LOCKSTAT_RESET, 0, 0);
+    exit(0);
+  }
+
+  if(argc > 1){
+    lockstat(LOCKSTAT_RESET, 0, 0);
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "lockstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+  print();
+  exit(0);
+}
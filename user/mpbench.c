@@ -0,0 +1,72 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+
+//
+// Multi-core scalability benchmark. Runs 1, 2, ... nproc
+// processes at once; each makes the same number of system
+// calls that touch shared kernel state (kmem.lock, the proc
+// table, ftable and inode locks, per-CPU data), so on a
+// kernel without false sharing or lock bottlenecks the
+// elapsed ticks should stay flat up to the number of CPUs.
+// Run it on kernels built before and after a change:
+//   $ mpbench 4
+//
+
+#define N 2000
+
+void
+work(void)
+{
+  struct stat st;
+  int fd, i;
+  char *p;
+
+  if((fd = open("mpbench", 0)) < 0){
+    fprintf(2, "mpbench: cannot open mpbench\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    if((p = sbrk(4096)) == (char*)-1){
+      fprintf(2, "mpbench: sbrk failed\n");
+      exit(1);
+    }
+    p[0] = i;
+    sbrk(-4096);
+    getpid();
+    fstat(fd, &st);
+  }
+  close(fd);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nproc, n, i, t0;
+
+  nproc = argc > 1 ? atoi(argv[1]) : 3;
+  if(nproc < 1){
+    fprintf(2, "usage: mpbench [nproc]\n");
+    exit(1);
+  }
+
+  for(n = 1; n <= nproc; n++){
+    t0 = uptime();
+    for(i = 0; i < n; i++){
+      int pid = fork();
+      if(pid < 0){
+        fprintf(2, "mpbench: fork failed\n");
+        exit(1);
+      }
+      if(pid == 0){
+        work();
+        exit(0);
+      }
+    }
+    for(i = 0; i < n; i++)
+      wait(0);
+    printf("mpbench: %d procs %d ticks\n", n, uptime() - t0);
+  }
+  exit(0);
+}
@@ -0,0 +1,102 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/riscv.h"
+
+//
+// Pipe throughput benchmark. A child reads everything the
+// parent writes through a pipe, for write sizes from one
+// byte up to a page, then whole pages moved by vmsplice();
+// each line reports KB/s for one way of writing.
+// Compare the numbers from kernels built before and after
+// a change to the pipe code:
+//   $ pipebench [kbytes]
+//
+
+char buf[4096];
+int sizes[] = { 1, 64, 512, 4096, 0 };
+char *pages;  // page-aligned, for vmsplice() and flipping reads
+
+#define NGIFT 4  // pages per vmsplice()
+
+// Send kb kilobytes through a pipe in writes of n bytes,
+// or by vmsplice() if n is 0; return the elapsed
+// nanoseconds.
+uint64
+run(int kb, int n)
+{
+  int fds[2], pid, left, m;
+  uint64 t0;
+  char *p;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "pipebench: pipe failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "pipebench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    p = n ? buf : pages;
+    while(read(fds[0], p, n ? sizeof(buf) : NGIFT*PGSIZE) > 0)
+      ;
+    exit(0);
+  }
+  close(fds[0]);
+  t0 = nanotime();
+  for(left = kb * 1024; left > 0; left -= m){
+    if(n == 0){
+      m = NGIFT*PGSIZE;
+      if(vmsplice(fds[1], pages, m) != m){
+        fprintf(2, "pipebench: vmsplice failed\n");
+        exit(1);
+      }
+      continue;
+    }
+    m = left < n ? left : n;
+    if(write(fds[1], buf, m) != m){
+      fprintf(2, "pipebench: write failed\n");
+      exit(1);
+    }
+  }
+  close(fds[1]);
+  wait(0);
+  return nanotime() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int kb, i, kbs;
+  uint64 ns;
+  char *p;
+
+  kb = argc > 1 ? atoi(argv[1]) : 1024;
+  if(kb < 1){
+    fprintf(2, "usage: pipebench [kbytes]\n");
+    exit(1);
+  }
+
+  p = sbrk(NGIFT*PGSIZE + PGSIZE);
+  if(p == (char*)-1){
+    fprintf(2, "pipebench: out of memory\n");
+    exit(1);
+  }
+  pages = (char*)PGROUNDUP((uint64)p);
+
+  for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+    // one-byte writes are slow; send less.
+    int n = sizes[i] == 1 ? (kb + 15) / 16 : kb;
+    ns = run(n, sizes[i]);
+    kbs = ns ? (uint64)n * 1000000000 / ns : 0;
+    if(sizes[i])
+      printf("pipebench: %d byte writes: ", sizes[i]);
+    else
+      printf("pipebench: vmsplice: ");
+    printf("%d KB in %d ms, %d KB/s\n", n, (int)(ns / 1000000), kbs);
+  }
+  exit(0);
+}
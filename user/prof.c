@@ -0,0 +1,87 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/prof.h"
+#include "kernel/rusage.h"
+#include "user/user.h"
+
+//
+// Profile a command with the kernel's timer-driven
+// sampler, on all CPUs, while the command runs:
+//   prof [-o file] cmd args
+// Each sample is printed as one line:
+//   prof: pid name u|k pc caller caller ...
+// Capture the console output (or the -o file) on the
+// host and turn it into folded stacks for a flame graph
+// with ./prof2folded.py.
+//
+
+struct profsample samples[16];
+
+void
+print(int fd, struct profsample *s)
+{
+  int i;
+
+  fprintf(fd, "prof: %d %s %s", s->pid, s->name, s->user ? "u" : "k");
+  for(i = 0; i < s->depth; i++)
+    fprintf(fd, " %p", s->pc[i]);
+  fprintf(fd, "\n");
+}
+
+// print the samples taken so far; returns how many.
+int
+drain(int fd)
+{
+  int n, i, total;
+
+  total = 0;
+  while((n = profctl(PROF_READ, (uint64)samples, 16)) > 0){
+    for(i = 0; i < n; i++)
+      print(fd, &samples[i]);
+    total += n;
+  }
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid;
+
+  fd = 1;
+  if(argc > 3 && strcmp(argv[1], "-o") == 0){
+    if((fd = open(argv[2], O_CREATE | O_WRONLY | O_TRUNC)) < 0){
+      fprintf(2, "prof: cannot open %s\n", argv[2]);
+      exit(1);
+    }
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: prof [-o file] cmd args...\n");
+    exit(1);
+  }
+
+  profctl(PROF_START, 0, 0);
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  for(;;){
+    if(drain(fd) == 0){
+      if(wait4(pid, 0, WNOHANG, 0) == pid)
+        break;
+      sleep(1);
+    }
+  }
+  profctl(PROF_STOP, 0, 0);
+  drain(fd);
+  exit(0);
+}
@@ -3,6 +3,7 @@
 #include "kernel/types.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/rusage.h"
 
 // Parsed command representation
 #define EXEC  1
@@ -141,6 +142,28 @@ getcmd(char *buf, int nbuf)
   return 0;
 }
 
+// Run cmd and report the time and other resources
+// it used, like time(1).
+void
+timecmd(char *cmd)
+{
+  struct rusage ru;
+  int pid, t0;
+
+  t0 = uptime();
+  if((pid = fork1()) == 0)
+    runcmd(parsecmd(cmd));
+  if(wait4(pid, 0, 0, &ru) < 0){
+    fprintf(2, "time: wait4 failed\n");
+    return;
+  }
+  fprintf(2, "%d real %d user %d sys ticks\n",
+          uptime() - t0, (int)ru.utime, (int)ru.stime);
+  fprintf(2, "%d syscalls %d+%d csw %d faults %d+%d blocks\n",
+          (int)ru.nsyscall, (int)ru.nvcsw, (int)ru.nivcsw,
+          (int)ru.nfault, (int)ru.inblock, (int)ru.oublock);
+}
+
 int
 main(void)
 {
@@ -164,6 +187,10 @@ main(void)
         fprintf(2, "cannot cd %s\n", buf+3);
       continue;
     }
+    if(buf[0] == 't' && buf[1] == 'i' && buf[2] == 'm' && buf[3] == 'e' && buf[4] == ' '){
+      timecmd(buf+5);
+      continue;
+    }
     if(fork1() == 0)
       runcmd(parsecmd(buf));
     wait(0);
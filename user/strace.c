@@ -0,0 +1,195 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/rusage.h"
+#include "kernel/systrace.h"
+#include "user/user.h"
+
+//
+// Trace or count the system calls a command makes.
+//   strace [-m mask] cmd args   log each call and return
+//   strace -c cmd args          print counts and latency
+//                               histograms per system call
+// mask selects system calls: either names separated by
+// commas, or a number, decimal or 0x hex, with bit
+// 1 << SYS_number for each. The default traces them all.
+//   strace -m read,write cat README
+//
+
+// system call numbers and names, generated by usys.pl.
+struct sysname {
+  uint64 num;
+  char *name;
+};
+extern struct sysname sysnames[];
+
+struct sysstat stats[NSYSCALL];
+struct tracerec recs[32];
+
+char*
+name(int num)
+{
+  struct sysname *s;
+
+  for(s = sysnames; s->name; s++)
+    if(s->num == num)
+      return s->name;
+  return "?";
+}
+
+// -m's argument as a mask; exits if it names an unknown call.
+uint64
+parsemask(char *arg)
+{
+  struct sysname *s;
+  uint64 mask;
+  char *p, *q;
+  int n, base;
+
+  if(*arg >= '0' && *arg <= '9'){
+    base = 10;
+    if(arg[0] == '0' && (arg[1] == 'x' || arg[1] == 'X')){
+      base = 16;
+      arg += 2;
+    }
+    mask = 0;
+    for(p = arg; *p; p++){
+      if(*p >= '0' && *p <= '9')
+        n = *p - '0';
+      else if(base == 16 && *p >= 'a' && *p <= 'f')
+        n = *p - 'a' + 10;
+      else if(base == 16 && *p >= 'A' && *p <= 'F')
+        n = *p - 'A' + 10;
+      else
+        break;
+      mask = mask * base + n;
+    }
+    if(*p == 0)
+      return mask;
+    fprintf(2, "strace: bad mask %s\n", arg);
+    exit(1);
+  }
+
+  mask = 0;
+  for(p = arg; *p; p = *q ? q + 1 : q){
+    for(q = p; *q && *q != ','; q++)
+      ;
+    for(s = sysnames; s->name; s++)
+      if(strlen(s->name) == q - p && memcmp(s->name, p, q - p) == 0)
+        break;
+    if(s->name == 0){
+      fprintf(2, "strace: unknown system call in %s\n", arg);
+      exit(1);
+    }
+    mask |= 1L << s->num;
+  }
+  return mask;
+}
+
+int
+run(char **argv, uint64 mask)
+{
+  int pid;
+
+  pid = fork();
+  if(pid < 0){
+    fprintf(2, "strace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    systrace(SYSTRACE_MASK, mask, 0);
+    exec(argv[0], argv);
+    fprintf(2, "strace: exec %s failed\n", argv[0]);
+    exit(1);
+  }
+  return pid;
+}
+
+// print the records in the trace log; returns how many.
+int
+drain(void)
+{
+  struct tracerec *r;
+  int n, i, total;
+
+  total = 0;
+  while((n = systrace(SYSTRACE_LOG_READ, (uint64)recs, 32)) > 0){
+    for(i = 0; i < n; i++){
+      r = &recs[i];
+      if(r->exit)
+        fprintf(2, "%d: %s -> %d\n", r->pid, name(r->num), (int)r->val[0]);
+      else
+        fprintf(2, "%d: %s(%p, %p, %p)\n", r->pid, name(r->num),
+                r->val[0], r->val[1], r->val[2]);
+    }
+    total += n;
+  }
+  return total;
+}
+
+void
+trace(char **argv, uint64 mask)
+{
+  int pid;
+
+  systrace(SYSTRACE_CTL, 0, SYSTRACE_LOG);
+  pid = run(argv, mask);
+  for(;;){
+    if(drain() == 0){
+      if(wait4(pid, 0, WNOHANG, 0) == pid)
+        break;
+      sleep(1);
+    }
+  }
+  systrace(SYSTRACE_CTL, 0, 0);
+  drain();
+}
+
+void
+count(char **argv)
+{
+  struct sysstat *s;
+  int i, b;
+
+  systrace(SYSTRACE_RESET, 0, 0);
+  systrace(SYSTRACE_CTL, 0, SYSTRACE_STATS);
+  wait4(run(argv, 0), 0, 0, 0);
+  systrace(SYSTRACE_CTL, 0, 0);
+
+  if(systrace(SYSTRACE_STATS_READ, (uint64)stats, NSYSCALL) < 0){
+    fprintf(2, "strace: cannot read statistics\n");
+    exit(1);
+  }
+  printf("syscall calls cycles/call  histogram (log2 cycles:calls)\n");
+  for(i = 0; i < NSYSCALL; i++){
+    s = &stats[i];
+    if(s->count == 0)
+      continue;
+    printf("%s %d %d ", name(i), (int)s->count, (int)(s->cycles / s->count));
+    for(b = 0; b < NSYSHIST; b++)
+      if(s->hist[b])
+        printf(" %d:%d", b, (int)s->hist[b]);
+    printf("\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint64 mask = ~0L;
+
+  if(argc > 2 && strcmp(argv[1], "-c") == 0){
+    count(argv + 2);
+    exit(0);
+  }
+  if(argc > 3 && strcmp(argv[1], "-m") == 0){
+    mask = parsemask(argv[2]);
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: strace [-c | -m mask] cmd args...\n");
+    exit(1);
+  }
+  trace(argv + 1, mask);
+  exit(0);
+}
@@ -2,6 +2,9 @@
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
 #include "user/user.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/seqlock.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -134,3 +137,35 @@ memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// getpid() without a system call.
+int
+ugetpid(void)
+{
+  struct usyscall *u = (struct usyscall *)USYSCALL;
+  return u->pid;
+}
+
+// uptime() without a system call.
+int
+uuptime(void)
+{
+  struct uclock *c = (struct uclock *)UCLOCK;
+  uint s, t;
+
+  do {
+    s = seq_readbegin(&c->seq);
+    t = c->ticks;
+  } while(seq_readretry(&c->seq, s));
+  return t;
+}
+
+// Nanoseconds since boot, without a system call.
+uint64
+nanotime(void)
+{
+  struct uclock *c = (struct uclock *)UCLOCK;
+  uint64 t = rdtime();
+
+  return t / c->freq * 1000000000 + t % c->freq * 1000000000 / c->freq;
+}
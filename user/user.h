@@ -1,5 +1,13 @@
 struct stat;
 struct rtcdate;
+struct ipcmsg;
+struct rusage;
+struct cycles;
+struct lockstat;
+struct uring;
+struct iovec;
+struct pollfd;
+struct bcachestat;
 
 // system calls
 int fork(void);
@@ -23,6 +31,56 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
+int endpoint(void);
+int ipc_call(int, struct ipcmsg*);
+int ipc_recv(int, struct ipcmsg*);
+int ipc_reply(int, struct ipcmsg*);
+int wait4(int, int*, int, struct rusage*);
+int getrusage(int, struct rusage*);
+int getcycles(struct cycles*);
+int lockbench(uint64, uint64);
+int lockstat(int, struct lockstat*, int);
+struct uring* ringsetup(void);
+int ringenter(int);
+int systrace(int, uint64, int);
+int profctl(int, uint64, int);
+int tracectl(int, uint64, int);
+int latstat(int, uint64, int);
+int readv(int, const struct iovec*, int);
+int writev(int, const struct iovec*, int);
+int pread(int, void*, int, int);
+int pwrite(int, const void*, int, int);
+int poll(struct pollfd*, int, int);
+int fcntl(int, int, int);
+int sendfile(int, int, int*, int);
+int splice(int, int, int);
+int vmsplice(int, void*, int);
+int bcachectl(int, struct bcachestat*, int);
+
+// hardware counters, which the kernel lets user mode read.
+static inline uint64
+rdcycle(void)
+{
+  uint64 x;
+  asm volatile("rdcycle %0" : "=r" (x) );
+  return x;
+}
+
+static inline uint64
+rdinstret(void)
+{
+  uint64 x;
+  asm volatile("rdinstret %0" : "=r" (x) );
+  return x;
+}
+
+static inline uint64
+rdtime(void)
+{
+  uint64 x;
+  asm volatile("rdtime %0" : "=r" (x) );
+  return x;
+}
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -40,3 +98,6 @@ void free(void*);
 int atoi(const char*);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
+int ugetpid(void);
+int uuptime(void);
+uint64 nanotime(void);
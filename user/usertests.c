@@ -7,6 +7,17 @@
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
+#include "kernel/ipc.h"
+#include "kernel/rusage.h"
+#include "kernel/lockstat.h"
+#include "kernel/uring.h"
+#include "kernel/systrace.h"
+#include "kernel/prof.h"
+#include "kernel/trace.h"
+#include "kernel/latency.h"
+#include "kernel/uio.h"
+#include "kernel/poll.h"
+#include "kernel/bcache.h"
 
 //
 // Tests xv6 system calls.  usertests without arguments runs them all
@@ -779,6 +790,1093 @@ pipe1(char *s)
   }
 }
 
+// synchronous call/reply through an ipc endpoint,
+// with message registers and a buffer in each direction.
+void
+ipc1(char *s)
+{
+  int ep, pid, i, j, xstatus;
+  struct ipcmsg m;
+  char b[64];
+  enum { N=100 };
+
+  if((ep = endpoint()) < 0){
+    printf("%s: endpoint() failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork() failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(;;){
+      memset(&m, 0, sizeof(m));
+      m.buf = (uint64)b;
+      m.size = sizeof(b);
+      if(ipc_recv(ep, &m) < 0){
+        printf("%s: ipc_recv failed\n", s);
+        exit(1);
+      }
+      m.mr[0] = m.mr[0] * 2;
+      for(j = 0; j < m.len; j++)
+        b[j] = b[j] + 1;
+      if(ipc_reply(ep, &m) < 0){
+        printf("%s: ipc_reply failed\n", s);
+        exit(1);
+      }
+    }
+  }
+
+  for(i = 0; i < N; i++){
+    for(j = 0; j < sizeof(b); j++)
+      b[j] = i + j;
+    m.mr[0] = i;
+    m.mr[3] = 7;
+    m.buf = (uint64)b;
+    m.len = sizeof(b);
+    m.size = sizeof(b);
+    if(ipc_call(ep, &m) != 0){
+      printf("%s: ipc_call failed\n", s);
+      exit(1);
+    }
+    if(m.mr[0] != 2*i || m.mr[3] != 7 || m.len != sizeof(b)){
+      printf("%s: wrong reply registers\n", s);
+      exit(1);
+    }
+    for(j = 0; j < sizeof(b); j++){
+      if(b[j] != (char)(i + j + 1)){
+        printf("%s: wrong reply buffer\n", s);
+        exit(1);
+      }
+    }
+  }
+
+  kill(pid);
+  wait(&xstatus);
+  close(ep);
+}
+
+// killing callers blocked in ipc_call(), before or after
+// the server has received their call, leaves the endpoint
+// and its server working.
+void
+ipckill(char *s)
+{
+  int ep, server, pid, i, xstatus;
+  struct ipcmsg m;
+  enum { N=20 };
+
+  if((ep = endpoint()) < 0){
+    printf("%s: endpoint() failed\n", s);
+    exit(1);
+  }
+  server = fork();
+  if(server < 0){
+    printf("%s: fork() failed\n", s);
+    exit(1);
+  }
+  if(server == 0){
+    for(;;){
+      memset(&m, 0, sizeof(m));
+      if((pid = ipc_recv(ep, &m)) <= 0){
+        printf("%s: ipc_recv failed\n", s);
+        exit(1);
+      }
+      sleep(1);
+      // the caller may be gone, so the reply may fail.
+      m.mr[0] = pid;
+      ipc_reply(ep, &m);
+    }
+  }
+
+  for(i = 0; i < N; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork() failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      for(;;){
+        memset(&m, 0, sizeof(m));
+        ipc_call(ep, &m);
+      }
+    }
+    sleep(i % 3);
+    kill(pid);
+    wait(&xstatus);
+  }
+
+  memset(&m, 0, sizeof(m));
+  if(ipc_call(ep, &m) != 0 || m.mr[0] != getpid()){
+    printf("%s: server stopped answering\n", s);
+    exit(1);
+  }
+  kill(server);
+  wait(&xstatus);
+  close(ep);
+}
+
+// a server that exits without replying fails the call,
+// and the endpoint can still be used afterwards.
+void
+ipcexit(char *s)
+{
+  int ep, pid, i, xstatus;
+  struct ipcmsg m;
+
+  if((ep = endpoint()) < 0){
+    printf("%s: endpoint() failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 2; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork() failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      memset(&m, 0, sizeof(m));
+      if(ipc_recv(ep, &m) <= 0)
+        exit(1);
+      // the first server walks away from the call.
+      if(i == 0)
+        exit(0);
+      m.mr[0] = 7;
+      exit(ipc_reply(ep, &m) < 0);
+    }
+    memset(&m, 0, sizeof(m));
+    if(ipc_call(ep, &m) != (i == 0 ? -1 : 0) || (i == 1 && m.mr[0] != 7)){
+      printf("%s: ipc_call %d returned the wrong result\n", s, i);
+      exit(1);
+    }
+    wait(&xstatus);
+    if(xstatus != 0){
+      printf("%s: server %d failed\n", s, i);
+      exit(1);
+    }
+  }
+  close(ep);
+}
+
+// wait4() reports a child's resource usage, and folds
+// it into the parent's RUSAGE_CHILDREN totals.
+void
+rusage1(char *s)
+{
+  struct rusage ru, cru;
+  int pid, i, xstatus;
+  enum { N=50 };
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork() failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < N; i++)
+      getpid();
+    sleep(1);
+    exit(0);
+  }
+  if(wait4(pid, &xstatus, 0, &ru) != pid || xstatus != 0){
+    printf("%s: wait4 failed\n", s);
+    exit(1);
+  }
+  if(ru.nsyscall < N || ru.nvcsw < 1){
+    printf("%s: child usage %d syscalls %d csw\n", s, (int)ru.nsyscall, (int)ru.nvcsw);
+    exit(1);
+  }
+  if(getrusage(RUSAGE_CHILDREN, &cru) < 0 || cru.nsyscall < ru.nsyscall){
+    printf("%s: children usage not accumulated\n", s);
+    exit(1);
+  }
+  if(wait4(-1, 0, WNOHANG, 0) != -1){
+    printf("%s: wait4 with no children should fail\n", s);
+    exit(1);
+  }
+}
+
+// user-mode counter reads work, and getcycles() charges a
+// user-mode loop to user time and system calls to the kernel.
+void
+cycles1(char *s)
+{
+  struct cycles c0, c1;
+  uint64 t0, t1;
+  volatile int i;
+
+  t0 = rdcycle();
+  if(getcycles(&c0) < 0){
+    printf("%s: getcycles failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 1000000; i++)
+    ;
+  getpid();
+  if(getcycles(&c1) < 0){
+    printf("%s: getcycles failed\n", s);
+    exit(1);
+  }
+  t1 = rdcycle();
+  if(t1 <= t0 || rdinstret() == 0){
+    printf("%s: counters not readable\n", s);
+    exit(1);
+  }
+  if(c1.ucycles <= c0.ucycles || c1.uinstret <= c0.uinstret ||
+     c1.kcycles <= c0.kcycles || c1.syscycles <= c0.syscycles){
+    printf("%s: counters did not advance\n", s);
+    exit(1);
+  }
+}
+
+// lockstat() reports the proc locks, and pipe locks
+// disappear once the pipe is freed.
+void
+lockstat1(char *s)
+{
+  static struct lockstat ls[64];
+  int n, i, fds[2], proc, pipes0, pipes1;
+
+  if(lockstat(LOCKSTAT_RESET, 0, 0) < 0){
+    printf("%s: lockstat reset failed\n", s);
+    exit(1);
+  }
+  getpid();
+  n = lockstat(LOCKSTAT_READ, ls, 64);
+  proc = pipes0 = 0;
+  for(i = 0; i < n; i++){
+    if(strcmp(ls[i].name, "proc") == 0 && !ls[i].sleep)
+      proc = ls[i].nlock == NPROC && ls[i].nacquire > 0;
+    if(strcmp(ls[i].name, "pipe") == 0)
+      pipes0 = ls[i].nlock;
+  }
+  if(!proc){
+    printf("%s: no stats for proc locks\n", s);
+    exit(1);
+  }
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  n = lockstat(LOCKSTAT_READ, ls, 64);
+  pipes1 = 0;
+  for(i = 0; i < n; i++)
+    if(strcmp(ls[i].name, "pipe") == 0)
+      pipes1 = ls[i].nlock;
+  if(pipes1 != pipes0){
+    printf("%s: freed pipe lock still listed\n", s);
+    exit(1);
+  }
+}
+
+// the USYSCALL and UCLOCK pages agree with the system
+// calls they stand in for, and are read-only.
+void
+ushared(char *s)
+{
+  uint64 t0, t1;
+  int pid, xstatus;
+
+  if(ugetpid() != getpid()){
+    printf("%s: ugetpid %d != getpid %d\n", s, ugetpid(), getpid());
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(ugetpid() != getpid())
+      exit(1);
+    *(int *)USYSCALL = 0;
+    exit(2);
+  }
+  wait(&xstatus);
+  if(xstatus != -1){
+    printf("%s: child got %d, wanted killed by store fault\n", s, xstatus);
+    exit(1);
+  }
+
+  t0 = nanotime();
+  if(uuptime() - uptime() > 1 || uptime() - uuptime() > 1){
+    printf("%s: uuptime and uptime disagree\n", s);
+    exit(1);
+  }
+  sleep(2);
+  t1 = nanotime();
+  if(t1 <= t0 || uuptime() < 2){
+    printf("%s: clock did not advance\n", s);
+    exit(1);
+  }
+}
+
+static void
+ringpush(struct uring *r, int op, int fd, uint64 addr, int n)
+{
+  struct sqe *e = &r->sq[r->sqtail & (URING_NENT-1)];
+
+  e->op = op;
+  e->fd = fd;
+  e->addr = addr;
+  e->n = n;
+  e->data = r->sqtail;
+  r->sqtail++;
+}
+
+// a batch of pipe, write, read and close operations
+// through the submission ring, then open, fstat and close.
+void
+uring1(char *s)
+{
+  struct uring *r;
+  struct stat st;
+  char buf[8];
+  int fds[2], i;
+
+  if((r = ringsetup()) == (struct uring *)-1){
+    printf("%s: ringsetup failed\n", s);
+    exit(1);
+  }
+  ringpush(r, URING_PIPE, 0, (uint64)fds, 0);
+  if(ringenter(1) != 1 || r->cqtail != 1 || r->cq[0].res != 0){
+    printf("%s: ring pipe failed\n", s);
+    exit(1);
+  }
+
+  ringpush(r, URING_WRITE, fds[1], (uint64)"hello", 5);
+  ringpush(r, URING_READ, fds[0], (uint64)buf, sizeof(buf));
+  ringpush(r, URING_CLOSE, fds[0], 0, 0);
+  ringpush(r, URING_CLOSE, fds[1], 0, 0);
+  ringpush(r, URING_READ, fds[0], (uint64)buf, sizeof(buf));
+  if(ringenter(10) != 5 || r->cqtail != 6){
+    printf("%s: ring batch not consumed\n", s);
+    exit(1);
+  }
+  for(i = 1; i < 6; i++){
+    if(r->cq[i].data != i){
+      printf("%s: completion %d out of order\n", s, i);
+      exit(1);
+    }
+  }
+  if(r->cq[1].res != 5 || r->cq[2].res != 5 || memcmp(buf, "hello", 5) != 0 ||
+     r->cq[3].res != 0 || r->cq[4].res != 0 || r->cq[5].res != -1){
+    printf("%s: wrong ring results\n", s);
+    exit(1);
+  }
+
+  ringpush(r, URING_OPEN, 0, (uint64)"ringfile", O_CREATE | O_RDWR);
+  r->cqhead = r->cqtail;
+  if(ringenter(1) != 1 || r->cq[6].res < 0){
+    printf("%s: ring open failed\n", s);
+    exit(1);
+  }
+  ringpush(r, URING_FSTAT, r->cq[6].res, (uint64)&st, 0);
+  ringpush(r, URING_CLOSE, r->cq[6].res, 0, 0);
+  if(ringenter(2) != 2 || r->cq[7].res != 0 || st.type != T_FILE ||
+     r->cq[8].res != 0){
+    printf("%s: ring fstat or close failed\n", s);
+    exit(1);
+  }
+  unlink("ringfile");
+}
+
+// system call statistics count calls, and the trace log
+// records the calls in the process's mask.
+void
+systrace1(char *s)
+{
+  static struct sysstat st[NSYSCALL];
+  static struct tracerec r[16];
+  int i, n, pid, found;
+
+  systrace(SYSTRACE_RESET, 0, 0);
+  systrace(SYSTRACE_CTL, 0, SYSTRACE_STATS);
+  for(i = 0; i < 100; i++)
+    getpid();
+  systrace(SYSTRACE_CTL, 0, 0);
+  if(systrace(SYSTRACE_STATS_READ, (uint64)st, NSYSCALL) != NSYSCALL ||
+     st[SYS_getpid].count < 100 || st[SYS_getpid].cycles == 0){
+    printf("%s: getpid calls not counted\n", s);
+    exit(1);
+  }
+
+  while(systrace(SYSTRACE_LOG_READ, (uint64)r, 16) > 0)
+    ;
+  systrace(SYSTRACE_MASK, 1L << SYS_getpid, 0);
+  systrace(SYSTRACE_CTL, 0, SYSTRACE_LOG);
+  pid = getpid();
+  uptime();
+  systrace(SYSTRACE_CTL, 0, 0);
+  systrace(SYSTRACE_MASK, 0, 0);
+  n = systrace(SYSTRACE_LOG_READ, (uint64)r, 16);
+  found = 0;
+  for(i = 0; i < n; i++){
+    if(r[i].pid != pid || r[i].num != SYS_getpid){
+      printf("%s: unexpected trace record for %d\n", s, r[i].num);
+      exit(1);
+    }
+    if(r[i].exit && r[i].val[0] == pid)
+      found = 1;
+  }
+  if(!found){
+    printf("%s: getpid not traced\n", s);
+    exit(1);
+  }
+}
+
+// the profiler samples a process spinning in user space.
+void
+prof1(char *s)
+{
+  static struct profsample ps[16];
+  int i, n, t0, found, pid = getpid();
+  volatile int j;
+
+  if(profctl(PROF_START, 0, 0) < 0){
+    printf("%s: profctl start failed\n", s);
+    exit(1);
+  }
+  found = 0;
+  t0 = uptime();
+  while(uptime() - t0 < 5){
+    for(j = 0; j < 1000000; j++)
+      ;
+    n = profctl(PROF_READ, (uint64)ps, 16);
+    for(i = 0; i < n; i++)
+      if(ps[i].pid == pid && ps[i].user && ps[i].depth >= 1 &&
+         ps[i].pc[0] < (uint64)sbrk(0))
+        found = 1;
+  }
+  profctl(PROF_STOP, 0, 0);
+  while(profctl(PROF_READ, (uint64)ps, 16) > 0)
+    ;
+  if(!found){
+    printf("%s: no user-mode samples\n", s);
+    exit(1);
+  }
+}
+
+// creating a file traces begin_op() and a commit, with
+// timestamps in order on each CPU.
+void
+ktrace1(char *s)
+{
+  static struct traceev ev[16];
+  uint64 last[NCPU];
+  int i, n, fd, begin, commit;
+
+  if(tracectl(TRACE_START, 0, 0) < 0){
+    printf("%s: tracectl start failed\n", s);
+    exit(1);
+  }
+  fd = open("ktracef", O_CREATE | O_RDWR);
+  if(fd < 0){
+    printf("%s: create failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("ktracef");
+  tracectl(TRACE_STOP, 0, 0);
+
+  begin = commit = 0;
+  memset(last, 0, sizeof(last));
+  while((n = tracectl(TRACE_READ, (uint64)ev, 16)) > 0){
+    for(i = 0; i < n; i++){
+      if(ev[i].cpu < 0 || ev[i].cpu >= NCPU || ev[i].time < last[ev[i].cpu]){
+        printf("%s: bad event cpu or time\n", s);
+        exit(1);
+      }
+      last[ev[i].cpu] = ev[i].time;
+      if(ev[i].type == EV_BEGIN_OP)
+        begin = 1;
+      if(ev[i].type == EV_COMMIT && ev[i].a0 == COMMIT_HEAD)
+        commit = 1;
+    }
+  }
+  if(!begin || !commit){
+    printf("%s: missing begin_op or commit events\n", s);
+    exit(1);
+  }
+}
+
+// latency tracking sees interrupts-off and lock-hold
+// intervals, reported worst first.
+void
+latency1(char *s)
+{
+  static struct latsite ls[4];
+  int i, n;
+
+  if(latstat(LAT_START, 0, 0) < 0){
+    printf("%s: latstat start failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 10; i++)
+    getpid();
+  sleep(1);
+  latstat(LAT_STOP, 0, 0);
+
+  n = latstat(LAT_READ_HOLD, (uint64)ls, 4);
+  if(n < 1 || ls[0].count == 0 || ls[0].pc == 0){
+    printf("%s: no lock-hold sites\n", s);
+    exit(1);
+  }
+  for(i = 1; i < n; i++){
+    if(ls[i].max > ls[i-1].max){
+      printf("%s: sites not sorted\n", s);
+      exit(1);
+    }
+  }
+  if(latstat(LAT_READ_IRQOFF, (uint64)ls, 4) < 1){
+    printf("%s: no interrupts-off sites\n", s);
+    exit(1);
+  }
+}
+
+// readv/writev scatter and gather; pread/pwrite use
+// their own offset and leave the file's alone.
+void
+rwvec(char *s)
+{
+  char *file = "rwvec";
+  char a[5], b[3000], c[7], buf[16];
+  struct iovec iov[3];
+  int fd, fds[2], i;
+
+  memset(a, 'a', sizeof(a));
+  memset(b, 'b', sizeof(b));
+  memset(c, 'c', sizeof(c));
+  unlink(file);
+  fd = open(file, O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  iov[0].iov_base = a; iov[0].iov_len = sizeof(a);
+  iov[1].iov_base = b; iov[1].iov_len = sizeof(b);
+  iov[2].iov_base = c; iov[2].iov_len = sizeof(c);
+  if(writev(fd, iov, 3) != sizeof(a)+sizeof(b)+sizeof(c)){
+    printf("%s: writev failed\n", s);
+    exit(1);
+  }
+
+  // overwrite the middle without moving fd's offset.
+  if(pwrite(fd, "xyz", 3, 4) != 3){
+    printf("%s: pwrite failed\n", s);
+    exit(1);
+  }
+  if(write(fd, "d", 1) != 1){
+    printf("%s: write after pwrite failed\n", s);
+    exit(1);
+  }
+  if(pread(fd, buf, 4, 3) != 4 || memcmp(buf, "axyz", 4) != 0){
+    printf("%s: pread wrong data\n", s);
+    exit(1);
+  }
+  if(pread(fd, buf, 4, sizeof(a)+sizeof(b)+sizeof(c)-1) != 2 ||
+     buf[0] != 'c' || buf[1] != 'd'){
+    printf("%s: pread at end wrong\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  // scatter the start of the file across two buffers.
+  fd = open(file, O_RDONLY);
+  iov[0].iov_base = buf; iov[0].iov_len = 2;
+  iov[1].iov_base = buf+2; iov[1].iov_len = 6;
+  if(readv(fd, iov, 2) != 8 || memcmp(buf, "aaaaxyzb", 8) != 0){
+    printf("%s: readv wrong data\n", s);
+    exit(1);
+  }
+  if(read(fd, buf, 1) != 1 || buf[0] != 'b'){
+    printf("%s: read after readv wrong\n", s);
+    exit(1);
+  }
+  if(pwrite(fd, "x", 1, 0) >= 0){
+    printf("%s: pwrite to read-only fd succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink(file);
+
+  // pipes have no offset.
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  iov[0].iov_base = "ab"; iov[0].iov_len = 2;
+  iov[1].iov_base = "cd"; iov[1].iov_len = 2;
+  if(writev(fds[1], iov, 2) != 4 || read(fds[0], buf, 4) != 4 ||
+     memcmp(buf, "abcd", 4) != 0){
+    printf("%s: writev to pipe failed\n", s);
+    exit(1);
+  }
+  if(pread(fds[0], buf, 1, 0) >= 0){
+    printf("%s: pread on pipe succeeded\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 2; i++)
+    close(fds[i]);
+}
+
+// poll() on several pipes, and O_NONBLOCK reads and writes.
+void
+poll1(char *s)
+{
+  static char buf[1024];
+  struct pollfd pfd[2];
+  int a[2], b[2], n, pid, xstatus;
+
+  if(pipe(a) < 0 || pipe(b) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pfd[0].fd = a[0]; pfd[0].events = POLLIN;
+  pfd[1].fd = b[0]; pfd[1].events = POLLIN;
+  if(poll(pfd, 2, 0) != 0 || poll(pfd, 2, 2) != 0){
+    printf("%s: empty pipes polled ready\n", s);
+    exit(1);
+  }
+
+  // a child writes to the second pipe while we wait.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    sleep(2);
+    write(b[1], "x", 1);
+    exit(0);
+  }
+  if(poll(pfd, 2, -1) != 1 || pfd[0].revents != 0 || pfd[1].revents != POLLIN){
+    printf("%s: poll missed pipe write\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+  if(read(b[0], buf, 1) != 1){
+    printf("%s: read after poll failed\n", s);
+    exit(1);
+  }
+
+  // non-blocking read of an empty pipe fails at once.
+  if(fcntl(a[0], F_SETFL, O_NONBLOCK) < 0 ||
+     fcntl(a[0], F_GETFL, 0) != (O_RDONLY|O_NONBLOCK)){
+    printf("%s: fcntl failed\n", s);
+    exit(1);
+  }
+  if(read(a[0], buf, 1) != -1){
+    printf("%s: non-blocking read didn't fail\n", s);
+    exit(1);
+  }
+
+  // non-blocking write to a full pipe writes what fits.
+  fcntl(a[1], F_SETFL, O_NONBLOCK);
+  n = 0;
+  while(write(a[1], buf, sizeof(buf)) > 0)
+    n++;
+  pfd[0].fd = a[1]; pfd[0].events = POLLOUT;
+  if(n == 0 || poll(pfd, 1, 0) != 0){
+    printf("%s: full pipe polled writable\n", s);
+    exit(1);
+  }
+  while(read(a[0], buf, sizeof(buf)) > 0)
+    ;
+  if(poll(pfd, 1, 0) != 1 || pfd[0].revents != POLLOUT){
+    printf("%s: drained pipe not writable\n", s);
+    exit(1);
+  }
+
+  // closing the write end wakes the reader with a hangup.
+  close(b[1]);
+  pfd[0].fd = b[0]; pfd[0].events = POLLIN;
+  if(poll(pfd, 1, -1) != 1 || !(pfd[0].revents & POLLHUP)){
+    printf("%s: no hangup\n", s);
+    exit(1);
+  }
+  close(a[0]);
+  close(a[1]);
+  close(b[0]);
+}
+
+// sendfile() and splice() move data between files and
+// pipes inside the kernel.
+void
+sendfile1(char *s)
+{
+  static char buf[3000];
+  char *src = "sendfile.src", *dst = "sendfile.dst";
+  int fd, out, fds[2], i, n, off, pid, xstatus;
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = 'a' + i % 26;
+  unlink(src);
+  fd = open(src, O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+    printf("%s: create %s failed\n", s, src);
+    exit(1);
+  }
+  close(fd);
+
+  // file to pipe, read by a child.
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    i = 0;
+    while((n = read(fds[0], buf, sizeof(buf))) > 0){
+      for(int j = 0; j < n; j++, i++){
+        if(buf[j] != 'a' + i % 26){
+          printf("%s: wrong byte %d through pipe\n", s, i);
+          exit(1);
+        }
+      }
+    }
+    exit(i == sizeof(buf) ? 0 : 1);
+  }
+  close(fds[0]);
+  fd = open(src, O_RDONLY);
+  if(sendfile(fds[1], fd, 0, sizeof(buf)) != sizeof(buf)){
+    printf("%s: sendfile to pipe failed\n", s);
+    exit(1);
+  }
+  close(fds[1]);
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(xstatus);
+
+  // file to file at an offset; fd's own offset stays put.
+  unlink(dst);
+  out = open(dst, O_CREATE|O_RDWR);
+  off = 1000;
+  if(sendfile(out, fd, &off, 5000) != sizeof(buf)-1000 || off != sizeof(buf)){
+    printf("%s: sendfile with offset failed\n", s);
+    exit(1);
+  }
+  if(read(fd, buf, 1) != 1 || buf[0] != 'a'){
+    printf("%s: sendfile moved the file offset\n", s);
+    exit(1);
+  }
+  close(fd);
+  if(pread(out, buf, 2, 0) != 2 || buf[0] != 'a' + 1000 % 26){
+    printf("%s: sendfile wrote wrong data\n", s);
+    exit(1);
+  }
+
+  // pipe to file; splice() needs a pipe at one end.
+  if(splice(out, out, 1) >= 0){
+    printf("%s: splice without a pipe succeeded\n", s);
+    exit(1);
+  }
+  pipe(fds);
+  write(fds[1], "spliced", 7);
+  close(fds[1]);
+  if(splice(fds[0], out, 100) != 7 || pread(out, buf, 7, sizeof(buf)-1000) != 7 ||
+     memcmp(buf, "spliced", 7) != 0){
+    printf("%s: splice from pipe failed\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(out);
+  unlink(src);
+  unlink(dst);
+}
+
+// fill fd, a non-blocking pipe write end; return bytes written.
+int
+pipefill(int fd)
+{
+  static char buf[1000];
+  int n, tot;
+
+  tot = 0;
+  while((n = write(fd, buf, sizeof(buf))) > 0)
+    tot += n;
+  return tot;
+}
+
+// pipes hold up to PIPEMAX bytes, and fcntl() can
+// change the capacity.
+void
+pipesize1(char *s)
+{
+  static char buf[1000];
+  int fds[2], n;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  if(fcntl(fds[0], F_GETPIPE_SZ, 0) != PIPEMAX || pipefill(fds[1]) != PIPEMAX){
+    printf("%s: pipe doesn't hold PIPEMAX bytes\n", s);
+    exit(1);
+  }
+  if(fcntl(fds[1], F_SETPIPE_SZ, 4096) >= 0){
+    printf("%s: shrank a pipe below its contents\n", s);
+    exit(1);
+  }
+
+  // drain it, then cap it at one page.
+  for(n = 0; n < PIPEMAX; n += sizeof(buf)){
+    if(read(fds[0], buf, sizeof(buf)) <= 0){
+      printf("%s: read failed\n", s);
+      exit(1);
+    }
+  }
+  if(fcntl(fds[1], F_SETPIPE_SZ, 100) != 4096 || pipefill(fds[1]) != 4096){
+    printf("%s: capacity not rounded to a page\n", s);
+    exit(1);
+  }
+  if(fcntl(0, F_GETPIPE_SZ, 0) >= 0){
+    printf("%s: pipe size of a non-pipe\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// vmsplice() hands whole pages to a pipe, and a page-aligned
+// read() takes them back out.
+void
+vmsplice1(char *s)
+{
+  char *a, *b;
+  int fds[2], i;
+
+  // two page-aligned 4-page buffers.
+  a = sbrk(0);
+  a = sbrk(PGROUNDUP((uint64)a) - (uint64)a + 8*PGSIZE);
+  if(a == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  a = (char*)PGROUNDUP((uint64)a);
+  b = a + 4*PGSIZE;
+  for(i = 0; i < 4*PGSIZE; i++)
+    a[i] = i % 251;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(vmsplice(fds[1], a + 1, PGSIZE) >= 0){
+    printf("%s: vmsplice of unaligned memory succeeded\n", s);
+    exit(1);
+  }
+  if(vmsplice(fds[1], a, 4*PGSIZE) != 4*PGSIZE){
+    printf("%s: vmsplice failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 4*PGSIZE; i++){
+    if(a[i] != 0){
+      printf("%s: gifted page not cleared\n", s);
+      exit(1);
+    }
+  }
+  if(read(fds[0], b, 4*PGSIZE) != 4*PGSIZE){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 4*PGSIZE; i++){
+    if(b[i] != (char)(i % 251)){
+      printf("%s: wrong data at %d\n", s, i);
+      exit(1);
+    }
+  }
+
+  // after a write() leaves the ring mid-page, vmsplice()
+  // waits for the reader to empty the pipe, so it never
+  // copies and the data still arrives in order.
+  write(fds[1], "x", 1);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  b[0] = 'y';
+  if(vmsplice(fds[1], b, PGSIZE) != -1 || b[0] != 'y'){
+    printf("%s: vmsplice into a mid-page ring\n", s);
+    exit(1);
+  }
+  if(read(fds[0], a, 1) != 1 || a[0] != 'x' ||
+     vmsplice(fds[1], b, PGSIZE) != PGSIZE || b[0] != 0 ||
+     read(fds[0], a, PGSIZE) != PGSIZE || a[0] != 'y'){
+    printf("%s: vmsplice after write failed\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// create file with n blocks of a known pattern.
+void
+bcachefile(char *s, char *file, int n)
+{
+  static char buf[BSIZE];
+  int fd, i, j;
+
+  unlink(file);
+  if((fd = open(file, O_CREATE|O_WRONLY)) < 0){
+    printf("%s: create failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < n; i++){
+    for(j = 0; j < BSIZE; j++)
+      buf[j] = i + j;
+    if(write(fd, buf, BSIZE) != BSIZE){
+      printf("%s: write failed\n", s);
+      exit(1);
+    }
+  }
+  close(fd);
+}
+
+// read file and check each byte; return 0 on success.
+int
+bcacheread(char *file, int n)
+{
+  static char buf[BSIZE];
+  int fd, i, j;
+
+  if((fd = open(file, O_RDONLY)) < 0)
+    return -1;
+  for(i = 0; i < n; i++){
+    if(read(fd, buf, BSIZE) != BSIZE)
+      return -1;
+    for(j = 0; j < BSIZE; j++)
+      if(buf[j] != (char)(i + j))
+        return -1;
+  }
+  close(fd);
+  return 0;
+}
+
+// the buffer cache grows to hold a file read twice, and
+// shrinks to its minimum on request.
+void
+bcache1(char *s)
+{
+  char *file = "bcache";
+  struct bcachestat st0, st1;
+  int n = 40;
+
+  bcachefile(s, file, n);
+
+  if(bcacheread(file, n) < 0){
+    printf("%s: first read failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_STAT, &st0, 0);
+  if(bcacheread(file, n) < 0){
+    printf("%s: second read failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_STAT, &st1, 0);
+  if(st0.nbuf <= st0.minbuf || st1.misses != st0.misses || st1.hits <= st0.hits){
+    printf("%s: second read missed the cache\n", s);
+    exit(1);
+  }
+
+  if(bcachectl(BCACHE_SETMAX, 0, st0.minbuf - 1) >= 0 ||
+     bcachectl(BCACHE_SETMAX, 0, st0.minbuf) < 0){
+    printf("%s: setmax failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_STAT, &st1, 0);
+  if(st1.nbuf != st1.minbuf || st1.reclaims == 0){
+    printf("%s: cache didn't shrink\n", s);
+    exit(1);
+  }
+  if(bcacheread(file, n) < 0){
+    printf("%s: read after shrink failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_SETMAX, 0, st0.max);
+  unlink(file);
+}
+
+// a sequential read of a file that isn't cached reads
+// ahead, and still returns the right data.
+void
+readahead1(char *s)
+{
+  char *file = "readahead";
+  struct bcachestat st0, st1;
+  int n = 100;
+
+  bcachefile(s, file, n);
+  // push the file out of the cache.
+  bcachectl(BCACHE_STAT, &st0, 0);
+  bcachectl(BCACHE_SETMAX, 0, st0.minbuf);
+  bcachectl(BCACHE_RESET, 0, 0);
+  if(bcacheread(file, n) < 0){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_STAT, &st1, 0);
+  bcachectl(BCACHE_SETMAX, 0, st0.max);
+  if(st1.readahead == 0){
+    printf("%s: no blocks read ahead\n", s);
+    exit(1);
+  }
+  unlink(file);
+}
+
+// the kernel's asynchronous block I/O completes several
+// requests in flight, running each write's callback.
+void
+bcacheasync(char *s)
+{
+  if(bcachectl(BCACHE_CHECK, 0, 0) != 0){
+    printf("%s: asynchronous block I/O check failed\n", s);
+    exit(1);
+  }
+}
+
+// reading a file much bigger than the cache leaves the
+// directory and inode blocks cached, unless built for LRU.
+void
+bcachescan(char *s)
+{
+  char *file = "bcscan";
+  struct bcachestat st0, st1;
+  int fd, max, n = 100;
+
+  bcachefile(s, file, n);
+  bcachectl(BCACHE_STAT, &st0, 0);
+  if(st0.lru){
+    unlink(file);
+    return;
+  }
+  max = st0.max;
+  bcachectl(BCACHE_SETMAX, 0, st0.minbuf);
+  if(bcacheread(file, n) < 0){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  bcachectl(BCACHE_STAT, &st1, 0);
+  if((fd = open(file, O_RDONLY)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  bcachectl(BCACHE_STAT, &st0, 0);
+  bcachectl(BCACHE_SETMAX, 0, max);
+  if(st0.misses != st1.misses){
+    printf("%s: scan evicted metadata\n", s);
+    exit(1);
+  }
+  unlink(file);
+}
 
 // test if child is killed (status = -1)
 void
@@ -1480,6 +2578,56 @@ concreate(char *s)
   }
 }
 
+// concurrent lookups, which lock directories shared, while
+// another process creates and unlinks files in them.
+void
+sharedlookup(char *s)
+{
+  struct stat st;
+  int i, j, fd, pid, xstatus;
+
+  if(mkdir("sldir") < 0){
+    printf("%s: mkdir sldir failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 4; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      for(j = 0; j < 100; j++){
+        if(i == 0){
+          fd = open("sldir/f", O_CREATE | O_RDWR);
+          if(fd < 0){
+            printf("%s: create sldir/f failed\n", s);
+            exit(1);
+          }
+          close(fd);
+          unlink("sldir/f");
+        } else {
+          if(stat("sldir/../sldir/.", &st) < 0 || st.type != T_DIR){
+            printf("%s: stat sldir failed\n", s);
+            exit(1);
+          }
+          stat("sldir/f", &st);
+        }
+      }
+      exit(0);
+    }
+  }
+  for(i = 0; i < 4; i++){
+    wait(&xstatus);
+    if(xstatus != 0)
+      exit(1);
+  }
+  if(unlink("sldir") < 0){
+    printf("%s: unlink sldir failed\n", s);
+    exit(1);
+  }
+}
+
 // another concurrent link/unlink/create test,
 // to look for deadlocks.
 void
@@ -2845,6 +3993,7 @@ main(int argc, char *argv[])
     {linktest, "linktest"},
     {unlinkread, "unlinkread"},
     {concreate, "concreate"},
+    {sharedlookup, "sharedlookup"},
     {subdir, "subdir"},
     {fourfiles, "fourfiles"},
     {sharedfd, "sharedfd"},
@@ -2871,6 +4020,27 @@ main(int argc, char *argv[])
     {iputtest, "iput"},
     {mem, "mem"},
     {pipe1, "pipe1"},
+    {ipc1, "ipc1"},
+    {ipckill, "ipckill"},
+    {ipcexit, "ipcexit"},
+    {rusage1, "rusage1"},
+    {cycles1, "cycles1"},
+    {lockstat1, "lockstat1"},
+    {ushared, "ushared"},
+    {uring1, "uring1"},
+    {systrace1, "systrace1"},
+    {prof1, "prof1"},
+    {ktrace1, "ktrace1"},
+    {latency1, "latency1"},
+    {rwvec, "rwvec"},
+    {poll1, "poll1"},
+    {sendfile1, "sendfile1"},
+    {pipesize1, "pipesize1"},
+    {vmsplice1, "vmsplice1"},
+    {bcache1, "bcache1"},
+    {readahead1, "readahead1"},
+    {bcachescan, "bcachescan"},
+    {bcacheasync, "bcacheasync"},
     {killstatus, "killstatus"},
     {preempt, "preempt"},
     {exitwait, "exitwait"},
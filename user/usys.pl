@@ -1,13 +1,17 @@
 #!/usr/bin/perl -w
 
-# Generate usys.S, the stubs for syscalls.
+# Generate usys.S, the stubs for syscalls, and sysnames[],
+# a table of their numbers and names ending with a 0 name.
 
 print "# generated by usys.pl - do not edit\n";
 
 print "#include \"kernel/syscall.h\"\n";
 
+my @names;
+
 sub entry {
     my $name = shift;
+    push(@names, $name);
     print ".global $name\n";
     print "${name}:\n";
     print " li a7, SYS_${name}\n";
@@ -36,3 +40,40 @@ entry("getpid");
 entry("sbrk");
 entry("sleep");
 entry("uptime");
+entry("endpoint");
+entry("ipc_call");
+entry("ipc_recv");
+entry("ipc_reply");
+entry("wait4");
+entry("getrusage");
+entry("getcycles");
+entry("lockbench");
+entry("lockstat");
+entry("ringsetup");
+entry("ringenter");
+entry("systrace");
+entry("profctl");
+entry("tracectl");
+entry("latstat");
+entry("readv");
+entry("writev");
+entry("pread");
+entry("pwrite");
+entry("poll");
+entry("fcntl");
+entry("sendfile");
+entry("splice");
+entry("vmsplice");
+entry("bcachectl");
+
+print ".section .rodata\n";
+foreach my $name (@names) {
+    print "sysname_${name}: .string \"${name}\"\n";
+}
+print ".balign 8\n";
+print ".global sysnames\n";
+print "sysnames:\n";
+foreach my $name (@names) {
+    print " .quad SYS_${name}, sysname_${name}\n";
+}
+print " .quad 0, 0\n";